@@ -2,8 +2,19 @@
 // File: SplitMix64.h
 
 #include <cstdint>
+#include <cstddef>
 #include <random>
 #include <limits>
+#include <cmath>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>     // _umul128 for uniform_int
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>  // 8-wide SplitMix64::fill (AVX-512), 4-lane Xoshiro256x4::fill (AVX2)
+#endif
 
 namespace RNG {
 
@@ -28,14 +39,49 @@ namespace RNG {
         // Cryptographically secure non-deterministic seeding, cannot be noexcept
         SplitMix64(NonDeterministic) noexcept(false) {
             std::random_device rd;
-            state = (static_cast<uint64_t>(rd()) >> 32) | (static_cast<uint64_t>(rd()));
+            state = (static_cast<uint64_t>(rd()) << 32) | static_cast<uint64_t>(rd());
         }
 
         constexpr u64 operator()() noexcept {
-            u64 z = (state += INCREMENT);
-            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
-            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
-            return z ^ (z >> 31);
+            return mix(state += INCREMENT);
+        }
+
+        // Next n outputs into out[0..n); same values and final state as n calls of operator().
+        // Output i depends only on state + (i + 1) * INCREMENT, so with AVX-512 (DQ) eight
+        // outputs are computed per step. AVX2 has no 64 bit multiply and its emulation
+        // measured no faster than the scalar loop, so other targets use the scalar loop.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"  // GCC 12 false positive inside AVX-512 intrinsics
+#endif
+        void fill(u64* out, size_t n) noexcept {
+            size_t i = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+            const __m512i m1 = _mm512_set1_epi64(static_cast<long long>(0xbf58476d1ce4e5b9ULL));
+            const __m512i m2 = _mm512_set1_epi64(static_cast<long long>(0x94d049bb133111ebULL));
+            const __m512i step = _mm512_set1_epi64(static_cast<long long>(INCREMENT * 8));
+            __m512i z = _mm512_add_epi64(_mm512_set1_epi64(static_cast<long long>(state)),
+                _mm512_mullo_epi64(_mm512_setr_epi64(1, 2, 3, 4, 5, 6, 7, 8),
+                                   _mm512_set1_epi64(static_cast<long long>(INCREMENT))));
+            for (size_t end = n & ~size_t(7); i < end; i += 8) {
+                __m512i x = _mm512_mullo_epi64(_mm512_xor_si512(z, _mm512_srli_epi64(z, 30)), m1);
+                x = _mm512_mullo_epi64(_mm512_xor_si512(x, _mm512_srli_epi64(x, 27)), m2);
+                _mm512_storeu_si512(out + i, _mm512_xor_si512(x, _mm512_srli_epi64(x, 31)));
+                z = _mm512_add_epi64(z, step);
+            }
+            state += INCREMENT * i;
+#endif
+            for (; i < n; ++i) out[i] = (*this)();
+        }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+        // A new generator for another thread, started at a random point of the 2^64 cycle.
+        // k streams of length L overlap with probability about k^2 * L / 2^64; for exact
+        // non-overlapping blocks give thread t a copy advanced with discard(t * L).
+        constexpr SplitMix64 split() noexcept {
+            return SplitMix64((*this)());
         }
 
         constexpr SplitMix64& discard(u64 n) noexcept {
@@ -45,5 +91,298 @@ namespace RNG {
 
         static constexpr result_type min()  noexcept { return 0; }
         static constexpr result_type max()  noexcept { return UINT64_MAX; }
+
+    private:
+        static constexpr u64 mix(u64 z) noexcept {
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+    };
+
+    // -----------------------------------------------------------------
+    // Xoshiro256** / Xoshiro256+ (Blackman & Vigna), seeded by SplitMix64
+    // -----------------------------------------------------------------
+    //
+    // 256 bit state, period 2^256 - 1. jump() advances by 2^128 steps and long_jump() by
+    // 2^192, so up to 2^64 (2^128 for long_jump) non-overlapping streams of 2^128 values can
+    // be carved from one seed. StarStar is the general-purpose variant; Plus is slightly
+    // faster but its lowest bits are weak, so use it for doubles (top 53 bits) only.
+
+    enum class XoshiroScrambler { StarStar, Plus };
+
+    template <XoshiroScrambler SCRAMBLER>
+    class Xoshiro256 {
+        using u64 = uint64_t;
+        u64 s[4];
+        template <XoshiroScrambler> friend class Xoshiro256x4;
+    public:
+        using result_type = u64;
+
+        // State from four SplitMix64 outputs, as the xoshiro authors recommend; SplitMix64
+        // never returns four zeros in a row, so the state is never all zero.
+        constexpr Xoshiro256(u64 seed = 0) noexcept : s{} {
+            SplitMix64 sm(seed);
+            for (u64& w : s) w = sm();
+        }
+        constexpr Xoshiro256(Deterministic, u64 seed) noexcept : Xoshiro256(seed) {}
+        Xoshiro256(NonDeterministic) noexcept(false) : Xoshiro256(SplitMix64(NonDeterministic())()) {}
+
+        constexpr u64 operator()() noexcept {
+            const u64 result = SCRAMBLER == XoshiroScrambler::StarStar ? rotl(s[1] * 5, 7) * 9 : s[0] + s[3];
+            const u64 t = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = rotl(s[3], 45);
+            return result;
+        }
+
+        void fill(u64* out, size_t n) noexcept {
+            for (size_t i = 0; i < n; ++i) out[i] = (*this)();
+        }
+
+        // Advance by 2^128 steps: give thread t the generator jumped t times.
+        constexpr void jump() noexcept {
+            constexpr u64 JUMP[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                      0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+            apply(JUMP);
+        }
+
+        // Advance by 2^192 steps: one long_jump per process or job, jump() within it.
+        constexpr void long_jump() noexcept {
+            constexpr u64 LONG_JUMP[4] = { 0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                                           0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+            apply(LONG_JUMP);
+        }
+
+        static constexpr result_type min()  noexcept { return 0; }
+        static constexpr result_type max()  noexcept { return UINT64_MAX; }
+
+    private:
+        static constexpr u64 rotl(u64 x, int k) noexcept { return (x << k) | (x >> (64 - k)); }
+
+        // Multiply the state by the jump polynomial: sum the states at the set bits.
+        constexpr void apply(const u64 (&poly)[4]) noexcept {
+            u64 t[4] = { 0, 0, 0, 0 };
+            for (u64 word : poly)
+                for (int b = 0; b < 64; ++b) {
+                    if (word & (u64(1) << b))
+                        for (int i = 0; i < 4; ++i) t[i] ^= s[i];
+                    (*this)();
+                }
+            for (int i = 0; i < 4; ++i) s[i] = t[i];
+        }
+    };
+
+    using Xoshiro256StarStar = Xoshiro256<XoshiroScrambler::StarStar>;
+    using Xoshiro256Plus = Xoshiro256<XoshiroScrambler::Plus>;
+
+    // Four Xoshiro256 streams, each jump()ed 2^128 steps past the previous, advanced together.
+    // Output is interleaved: lane 0, 1, 2, 3, lane 0, ... operator() and fill() give the same
+    // sequence. fill() steps the four lanes in AVX2 registers (the ** multiplies by 5 and 9
+    // are shift-adds); without AVX2 the lanes are interleaved in scalar code.
+    template <XoshiroScrambler SCRAMBLER>
+    class Xoshiro256x4 {
+        using u64 = uint64_t;
+        u64 s[4][4];        // s[word][lane]
+        u64 buffered[4];    // outputs of the last step not yet returned
+        int next = 4;
+    public:
+        using result_type = u64;
+
+        explicit Xoshiro256x4(u64 seed = 0) noexcept : Xoshiro256x4(Xoshiro256<SCRAMBLER>(seed)) {}
+        explicit Xoshiro256x4(Xoshiro256<SCRAMBLER> g) noexcept {
+            for (int lane = 0; lane < 4; ++lane) {
+                for (int w = 0; w < 4; ++w) s[w][lane] = g.s[w];
+                g.jump();
+            }
+        }
+
+        u64 operator()() noexcept {
+            if (next == 4) { step(buffered); next = 0; }
+            return buffered[next++];
+        }
+
+        void fill(u64* out, size_t n) noexcept {
+            size_t i = 0;
+            for (; i < n && next < 4; ++i) out[i] = buffered[next++];
+#if defined(__AVX2__)
+            __m256i s0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s[0]));
+            __m256i s1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s[1]));
+            __m256i s2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s[2]));
+            __m256i s3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s[3]));
+            for (; i + 4 <= n; i += 4) {
+                __m256i r;
+                if (SCRAMBLER == XoshiroScrambler::StarStar) {
+                    r = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);                 // s1 * 5
+                    r = _mm256_or_si256(_mm256_slli_epi64(r, 7), _mm256_srli_epi64(r, 57));
+                    r = _mm256_add_epi64(_mm256_slli_epi64(r, 3), r);                   // * 9
+                }
+                else {
+                    r = _mm256_add_epi64(s0, s3);
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), r);
+                __m256i t = _mm256_slli_epi64(s1, 17);
+                s2 = _mm256_xor_si256(s2, s0);
+                s3 = _mm256_xor_si256(s3, s1);
+                s1 = _mm256_xor_si256(s1, s2);
+                s0 = _mm256_xor_si256(s0, s3);
+                s2 = _mm256_xor_si256(s2, t);
+                s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 19));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(s[0]), s0);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(s[1]), s1);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(s[2]), s2);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(s[3]), s3);
+#else
+            for (; i + 4 <= n; i += 4) step(out + i);
+#endif
+            for (; i < n; ++i) out[i] = (*this)();
+        }
+
+        static constexpr result_type min()  noexcept { return 0; }
+        static constexpr result_type max()  noexcept { return UINT64_MAX; }
+
+    private:
+        static u64 rotl(u64 x, int k) noexcept { return (x << k) | (x >> (64 - k)); }
+
+        void step(u64 out[4]) noexcept {
+            for (int l = 0; l < 4; ++l) {
+                out[l] = SCRAMBLER == XoshiroScrambler::StarStar ? rotl(s[1][l] * 5, 7) * 9 : s[0][l] + s[3][l];
+                const u64 t = s[1][l] << 17;
+                s[2][l] ^= s[0][l];
+                s[3][l] ^= s[1][l];
+                s[1][l] ^= s[2][l];
+                s[0][l] ^= s[3][l];
+                s[2][l] ^= t;
+                s[3][l] = rotl(s[3][l], 45);
+            }
+        }
     };
+
+    using Xoshiro256StarStarX4 = Xoshiro256x4<XoshiroScrambler::StarStar>;
+    using Xoshiro256PlusX4 = Xoshiro256x4<XoshiroScrambler::Plus>;
+
+    // -----------------------------------------------------------------
+    // Batched distributions for any generator with fill(uint64_t*, size_t)
+    // -----------------------------------------------------------------
+
+    namespace detail {
+        inline uint64_t mul_hi(uint64_t a, uint64_t b, uint64_t& lo) noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+            uint64_t hi;
+            lo = _umul128(a, b, &hi);
+            return hi;
+#else
+            __uint128_t m = static_cast<__uint128_t>(a) * b;
+            lo = static_cast<uint64_t>(m);
+            return static_cast<uint64_t>(m >> 64);
+#endif
+        }
+
+        constexpr size_t BATCH = 256;   // raw outputs generated per fill() call
+    }
+
+    // n unbiased integers in [lo, hi] (inclusive, lo <= hi) by Lemire's nearly divisionless
+    // method: the high half of x * range is the result, redrawn only when the low half falls
+    // below 2^w mod range (w = 32 or 64). Each batch is mapped in one branch-free pass that
+    // the compiler can vectorize; the rare candidates for rejection are fixed up in a second
+    // pass, which also computes the remainder (the only division) at most once per call.
+    // Ranges below 2^32 use 32 bit draws, two per generator output.
+    template <class Gen, class T>
+    void uniform_int(Gen& gen, T* out, size_t n, T lo, T hi) noexcept {
+        static_assert(std::is_integral<T>::value && sizeof(T) <= 8, "uniform_int: integer type up to 64 bits");
+        using S = typename std::conditional<std::is_signed<T>::value, int64_t, uint64_t>::type;
+        const uint64_t base = static_cast<uint64_t>(static_cast<S>(lo));
+        const uint64_t range = static_cast<uint64_t>(static_cast<S>(hi)) - base + 1;   // 0: all 2^64 values
+        auto put = [&](size_t i, uint64_t v) { out[i] = static_cast<T>(static_cast<S>(base + v)); };
+        uint64_t raw[detail::BATCH];
+
+        if (range == 0) {
+            for (size_t i = 0; i < n; i += detail::BATCH) {
+                size_t k = n - i < detail::BATCH ? n - i : detail::BATCH;
+                gen.fill(raw, k);
+                for (size_t j = 0; j < k; ++j) put(i + j, raw[j]);
+            }
+        }
+        else if (range < (uint64_t(1) << 32)) {
+            const uint32_t r = static_cast<uint32_t>(range);     // 32x32 -> 64 bit products
+            uint32_t x[2 * detail::BATCH];
+            uint32_t threshold = 0;
+            bool have_threshold = false;
+            for (size_t i = 0; i < n; i += 2 * detail::BATCH) {
+                size_t k = n - i < 2 * detail::BATCH ? n - i : 2 * detail::BATCH;
+                gen.fill(raw, (k + 1) / 2);
+                for (size_t j = 0; j < (k + 1) / 2; ++j) {
+                    x[2 * j] = static_cast<uint32_t>(raw[j]);
+                    x[2 * j + 1] = static_cast<uint32_t>(raw[j] >> 32);
+                }
+                uint32_t suspect = 0;
+                for (size_t j = 0; j < k; ++j) {
+                    uint64_t m = static_cast<uint64_t>(x[j]) * r;
+                    put(i + j, m >> 32);
+                    suspect |= static_cast<uint32_t>(m) < r;
+                }
+                if (!suspect) continue;
+                if (!have_threshold) {
+                    threshold = static_cast<uint32_t>(0 - r) % r;
+                    have_threshold = true;
+                }
+                for (size_t j = 0; j < k; ++j) {
+                    uint64_t m = static_cast<uint64_t>(x[j]) * r;
+                    if (static_cast<uint32_t>(m) >= threshold) continue;
+                    do m = (gen() >> 32) * r; while (static_cast<uint32_t>(m) < threshold);
+                    put(i + j, m >> 32);
+                }
+            }
+        }
+        else {
+            uint64_t threshold = 0;
+            bool have_threshold = false;
+            for (size_t i = 0; i < n; i += detail::BATCH) {
+                size_t k = n - i < detail::BATCH ? n - i : detail::BATCH;
+                gen.fill(raw, k);
+                uint64_t suspect = 0;
+                for (size_t j = 0; j < k; ++j) {
+                    uint64_t low;
+                    put(i + j, detail::mul_hi(raw[j], range, low));
+                    suspect |= low < range;
+                }
+                if (!suspect) continue;
+                if (!have_threshold) {
+                    threshold = (0 - range) % range;
+                    have_threshold = true;
+                }
+                for (size_t j = 0; j < k; ++j) {
+                    uint64_t low;
+                    detail::mul_hi(raw[j], range, low);
+                    if (low >= threshold) continue;
+                    uint64_t v;
+                    do v = detail::mul_hi(gen(), range, low); while (low < threshold);
+                    put(i + j, v);
+                }
+            }
+        }
+    }
+
+    // n doubles uniform in [lo, hi): 53 random bits per value, scaled. For lo = 0, hi = 1 the
+    // result is exact; other ranges round, and a value that rounds up to hi is replaced by
+    // the largest double below it.
+    template <class Gen>
+    void uniform_double(Gen& gen, double* out, size_t n, double lo = 0.0, double hi = 1.0) noexcept {
+        const double scale = (hi - lo) * (1.0 / 9007199254740992.0);   // (hi - lo) / 2^53
+        const double top = std::nextafter(hi, lo);
+        uint64_t raw[detail::BATCH];
+        for (size_t i = 0; i < n; i += detail::BATCH) {
+            size_t k = n - i < detail::BATCH ? n - i : detail::BATCH;
+            gen.fill(raw, k);
+            for (size_t j = 0; j < k; ++j) {
+                double v = lo + static_cast<double>(raw[j] >> 11) * scale;
+                out[i + j] = v < hi ? v : top;
+            }
+        }
+    }
 }
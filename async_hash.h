@@ -0,0 +1,454 @@
+#pragma once
+// File: async_hash.h
+// Description: C++20 coroutine pipeline hashing many concurrent streams on one thread
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>              // uint64_t, uint8_t
+#include <cstddef>              // size_t
+#include <cstring>              // memcpy
+#include <coroutine>            // std::coroutine_handle, std::suspend_always
+#include <deque>                // std::deque ready queue and waiters
+#include <exception>            // std::exception_ptr
+#include <memory>               // std::unique_ptr
+#include <optional>             // std::optional task results
+#include <stdexcept>            // std::logic_error
+#include <system_error>         // std::system_error
+#include <utility>              // std::exchange, std::move
+#include <vector>               // std::vector
+
+#if !defined(__cpp_impl_coroutine)
+#error "async_hash.h requires C++20 coroutines (-std=c++20, /std:c++20)"
+#endif
+#if !defined(__linux__)
+#error "async_hash.h uses epoll and currently requires Linux"
+#endif
+#include <cerrno>               // errno, EAGAIN
+#include <sys/epoll.h>          // epoll_create1, epoll_ctl, epoll_wait
+#include <unistd.h>             // read, close
+
+#include "compact_hash.h"
+
+/*
+compact_hash::async - Hash thousands of concurrent streams on a single thread
+
+A coroutine per stream reads from a Source into two buffers leased from a shared
+BufferPool and feeds a CompactHash. The read into the second buffer is issued
+before the first one is hashed, so on a socket or pipe the next read is already
+parked in epoll (or completed) while the CPU works. Streams waiting for data cost
+one suspended coroutine frame and their buffer lease, not a thread and its stack.
+
+The digest equals compact_hash() of the concatenated stream, independent of how
+reads happen to be fragmented: partial 16-byte blocks are carried between reads.
+
+Pieces:
+    Task<T>          lazy coroutine result, awaitable, symmetric transfer
+    EventLoop        epoll readiness loop plus a ready queue; spawn() + run()
+    BufferPool       fixed number of fixed-size buffers, leased in pairs
+    FdSource         non-blocking fd (socket, pipe) or regular file
+    GeneratorSource  any callable size_t(uint8_t* dst, size_t capacity), 0 at end
+    hash_stream()    the per-stream pipeline, returns Task<uint64_t>
+
+Errors from read() surface as std::system_error when the task is awaited, or from
+EventLoop::run() for spawned tasks.
+
+Usage example:
+
+    using namespace compact_hash::async;
+    EventLoop loop;
+    BufferPool pool(loop, 2 * 256, 64 * 1024);     // memory bound: 32 MiB
+    std::vector<uint64_t> digests(fds.size());
+    for (size_t i = 0; i < fds.size(); ++i)
+        loop.spawn([](EventLoop& loop, BufferPool& pool, int fd, uint64_t& out) -> Task<> {
+            FdSource src(loop, fd);
+            out = co_await hash_stream(src, pool);
+        }(loop, pool, fds[i], digests[i]));
+    loop.run();
+*/
+
+namespace compact_hash {
+namespace async {
+
+    template <class T = void> class Task;
+
+    namespace detail {
+
+        struct PromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+            bool started = false;
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct FinalAwaiter {
+                bool await_ready() noexcept { return false; }
+                template <class P>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+                    std::coroutine_handle<> c = h.promise().continuation;
+                    return c ? c : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            void unhandled_exception() noexcept { error = std::current_exception(); }
+        };
+
+        template <class T>
+        struct Promise : PromiseBase {
+            std::optional<T> value;
+            Task<T> get_return_object() noexcept;
+            template <class U>
+            void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+            T take() {
+                if (error) std::rethrow_exception(error);
+                return std::move(*value);
+            }
+        };
+
+        template <>
+        struct Promise<void> : PromiseBase {
+            Task<void> get_return_object() noexcept;
+            void return_void() noexcept {}
+            void take() {
+                if (error) std::rethrow_exception(error);
+            }
+        };
+
+    }//namespace detail
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Lazy coroutine. Runs when awaited, or earlier if start() is called; awaiting a
+    // task that already finished does not suspend.
+    template <class T>
+    class Task {
+    public:
+        using promise_type = detail::Promise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        Task() noexcept = default;
+        explicit Task(handle_type h) noexcept : h(h) {}
+        Task(Task&& o) noexcept : h(std::exchange(o.h, {})) {}
+        Task& operator=(Task&& o) noexcept { if (this != &o) { destroy(); h = std::exchange(o.h, {}); } return *this; }
+        ~Task() { destroy(); }
+
+        // Run until the first suspension point without waiting for the result.
+        void start() {
+            if (!h.promise().started) {
+                h.promise().started = true;
+                h.resume();
+            }
+        }
+
+        bool done() const noexcept { return h && h.done(); }
+
+        // Result of a finished task; rethrows its exception.
+        decltype(auto) result() { return h.promise().take(); }
+
+        auto operator co_await() noexcept {
+            struct Awaiter {
+                handle_type h;
+                bool await_ready() noexcept { return h.done(); }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) noexcept {
+                    h.promise().continuation = c;
+                    if (h.promise().started) return std::noop_coroutine();   // resumes us when it finishes
+                    h.promise().started = true;
+                    return h;
+                }
+                decltype(auto) await_resume() { return h.promise().take(); }
+            };
+            return Awaiter{ h };
+        }
+
+    private:
+        void destroy() noexcept { if (h) h.destroy(); }
+        handle_type h;
+    };//class Task
+
+    namespace detail {
+        template <class T>
+        Task<T> Promise<T>::get_return_object() noexcept { return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this)); }
+        inline Task<void> Promise<void>::get_return_object() noexcept { return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this)); }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    class EventLoop {
+    public:
+        EventLoop() : epfd(epoll_create1(EPOLL_CLOEXEC)) {
+            if (epfd < 0) throw std::system_error(errno, std::generic_category(), "epoll_create1");
+        }
+        ~EventLoop() { close(epfd); }
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        // Queue h to be resumed by run().
+        void post(std::coroutine_handle<> h) { ready.push_back(h); }
+
+        // Let other ready coroutines run first.
+        auto yield() noexcept {
+            struct Awaiter {
+                EventLoop& loop;
+                bool await_ready() noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> h) { loop.post(h); }
+                void await_resume() noexcept {}
+            };
+            return Awaiter{ *this };
+        }
+
+        // Suspend until fd is readable (or hung up). Regular files cannot be polled
+        // and resume immediately.
+        auto readable(int fd) noexcept {
+            struct Awaiter {
+                EventLoop& loop;
+                int fd;
+                bool await_ready() noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> h) {
+                    epoll_event ev{};
+                    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+                    ev.data.ptr = h.address();
+                    if (epoll_ctl(loop.epfd, EPOLL_CTL_MOD, fd, &ev) == 0 ||
+                        epoll_ctl(loop.epfd, EPOLL_CTL_ADD, fd, &ev) == 0) {
+                        ++loop.waiting;
+                        return;
+                    }
+                    if (errno != EPERM) throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+                    loop.post(h);
+                }
+                void await_resume() noexcept {}
+            };
+            return Awaiter{ *this, fd };
+        }
+
+        // Drop fd from the epoll set; call before closing a polled fd.
+        void forget(int fd) noexcept { epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr); }
+
+        // Start a top-level task; run() drives it to completion.
+        void spawn(Task<void> t) {
+            spawned.push_back(std::move(t));
+            spawned.back().start();
+        }
+
+        // Run until every spawned task finished. Rethrows the first task exception.
+        void run() {
+            epoll_event events[64];
+            for (;;) {
+                while (!ready.empty()) {
+                    std::coroutine_handle<> h = ready.front();
+                    ready.pop_front();
+                    h.resume();
+                }
+                reap();
+                if (spawned.empty()) return;
+                if (waiting == 0) throw std::logic_error("async::EventLoop: tasks blocked with nothing to wait for");
+                int n = epoll_wait(epfd, events, 64, -1);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::system_error(errno, std::generic_category(), "epoll_wait");
+                }
+                for (int i = 0; i < n; ++i) {
+                    --waiting;
+                    post(std::coroutine_handle<>::from_address(events[i].data.ptr));
+                }
+            }
+        }
+
+    private:
+        void reap() {
+            for (size_t i = 0; i < spawned.size();) {
+                if (!spawned[i].done()) { ++i; continue; }
+                Task<void> t = std::move(spawned[i]);
+                spawned[i] = std::move(spawned.back());
+                spawned.pop_back();
+                t.result();
+            }
+        }
+
+        int epfd;
+        size_t waiting = 0;     // coroutines parked in epoll
+        std::deque<std::coroutine_handle<>> ready;
+        std::vector<Task<void>> spawned;
+    };//class EventLoop
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Fixed pool of equally sized buffers. Leases of several buffers are granted
+    // whole and in FIFO order, so streams needing two buffers cannot deadlock by
+    // each holding one.
+    class BufferPool {
+    public:
+        class Lease {
+        public:
+            Lease() = default;
+            Lease(BufferPool* pool, std::vector<uint8_t*> bufs) : pool(pool), bufs(std::move(bufs)) {}
+            Lease(Lease&& o) noexcept : pool(std::exchange(o.pool, nullptr)), bufs(std::move(o.bufs)) {}
+            Lease& operator=(Lease&& o) noexcept { release(); pool = std::exchange(o.pool, nullptr); bufs = std::move(o.bufs); return *this; }
+            ~Lease() { release(); }
+
+            uint8_t* operator[](size_t i) const noexcept { return bufs[i]; }
+            size_t count() const noexcept { return bufs.size(); }
+
+        private:
+            void release() {
+                if (pool) pool->give_back(bufs);
+                pool = nullptr;
+                bufs.clear();
+            }
+            BufferPool* pool = nullptr;
+            std::vector<uint8_t*> bufs;
+        };
+
+        BufferPool(EventLoop& loop, size_t count, size_t buffer_size)
+            : loop(loop), size(buffer_size), storage(new uint8_t[count * buffer_size]) {
+            for (size_t i = 0; i < count; ++i) free_list.push_back(storage.get() + i * buffer_size);
+        }
+
+        size_t buffer_size() const noexcept { return size; }
+
+        // co_await acquire(n) yields a Lease of n buffers (n <= pool size).
+        auto acquire(size_t n) {
+            struct Awaiter {
+                BufferPool& pool;
+                size_t n;
+                Lease lease;
+                bool await_ready() {
+                    if (!pool.waiters.empty() || pool.free_list.size() < n) return false;
+                    lease = pool.take(n);
+                    return true;
+                }
+                void await_suspend(std::coroutine_handle<> h) { pool.waiters.push_back({ h, n, &lease }); }
+                Lease await_resume() { return std::move(lease); }
+            };
+            return Awaiter{ *this, n, {} };
+        }
+
+    private:
+        struct Waiter {
+            std::coroutine_handle<> h;
+            size_t n;
+            Lease* out;
+        };
+
+        Lease take(size_t n) {
+            std::vector<uint8_t*> bufs(free_list.end() - n, free_list.end());
+            free_list.resize(free_list.size() - n);
+            return Lease(this, std::move(bufs));
+        }
+
+        void give_back(const std::vector<uint8_t*>& bufs) {
+            free_list.insert(free_list.end(), bufs.begin(), bufs.end());
+            while (!waiters.empty() && free_list.size() >= waiters.front().n) {
+                Waiter w = waiters.front();
+                waiters.pop_front();
+                *w.out = take(w.n);
+                loop.post(w.h);
+            }
+        }
+
+        EventLoop& loop;
+        size_t size;
+        std::unique_ptr<uint8_t[]> storage;
+        std::vector<uint8_t*> free_list;
+        std::deque<Waiter> waiters;
+    };//class BufferPool
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Sources: Task<size_t> read(uint8_t* dst, size_t capacity), 0 at end of stream
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Reads an fd the caller owns. Sockets and pipes should be O_NONBLOCK; regular
+    // files are read directly.
+    class FdSource {
+    public:
+        FdSource(EventLoop& loop, int fd) noexcept : loop(loop), fd(fd) {}
+
+        Task<size_t> read(uint8_t* dst, size_t capacity) {
+            for (;;) {
+                ssize_t r = ::read(fd, dst, capacity);
+                if (r >= 0) co_return static_cast<size_t>(r);
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    throw std::system_error(errno, std::generic_category(), "read");
+                co_await loop.readable(fd);
+            }
+        }
+
+    private:
+        EventLoop& loop;
+        int fd;
+    };//class FdSource
+
+    // Wraps a synchronous producer. Yields to the loop on every read so one fast
+    // generator cannot starve the other streams.
+    template <class F>
+    class GeneratorSource {
+    public:
+        GeneratorSource(EventLoop& loop, F produce) : loop(loop), produce(std::move(produce)) {}
+
+        Task<size_t> read(uint8_t* dst, size_t capacity) {
+            co_await loop.yield();
+            co_return produce(dst, capacity);
+        }
+
+    private:
+        EventLoop& loop;
+        F produce;
+    };//class GeneratorSource
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Feeds arbitrary fragments to CompactHash in whole 16-byte blocks, so the digest
+    // equals compact_hash() of the concatenation regardless of fragmentation.
+    class BlockFeeder {
+    public:
+        explicit BlockFeeder(uint64_t seed) noexcept : h(seed) {}
+
+        void feed(const uint8_t* p, size_t n) noexcept {
+            if (carry_n) {
+                size_t take = n < 16 - carry_n ? n : 16 - carry_n;
+                memcpy(carry + carry_n, p, take);
+                carry_n += take;
+                p += take;
+                n -= take;
+                if (carry_n < 16) return;
+                h.insert(carry, 16);
+                carry_n = 0;
+            }
+            size_t whole = n & ~size_t(15);
+            h.insert(p, whole);
+            memcpy(carry, p + whole, n - whole);
+            carry_n = n - whole;
+        }
+
+        uint64_t finalize() noexcept {
+            h.insert(carry, carry_n);
+            return h.finalize();
+        }
+
+    private:
+        CompactHash h;
+        uint8_t carry[16];
+        size_t carry_n = 0;
+    };//class BlockFeeder
+
+    // Hash a whole stream with double buffering: the read into one buffer is issued
+    // before the other buffer is hashed.
+    template <class Source>
+    Task<uint64_t> hash_stream(Source& src, BufferPool& pool, uint64_t seed = 0) {
+        BufferPool::Lease bufs = co_await pool.acquire(2);
+        const size_t cap = pool.buffer_size();
+        BlockFeeder feeder(seed);
+        size_t cur = 0;
+        size_t n = co_await src.read(bufs[cur], cap);
+        while (n > 0) {
+            Task<size_t> next = src.read(bufs[cur ^ 1], cap);
+            next.start();
+            feeder.feed(bufs[cur], n);
+            n = co_await next;
+            cur ^= 1;
+        }
+        co_return feeder.finalize();
+    }
+
+}//namespace async
+}//namespace compact_hash
@@ -0,0 +1,265 @@
+// File: bench_tables.cpp
+// Description: Hash-table workload benchmark across key distributions, load factors and table sizes
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+//
+// Build (single translation unit, POSIX for the HashIndex rows):
+//     g++ -O3 -march=native -std=c++17 bench_tables.cpp -o bench_tables
+//
+// Usage:
+//     ./bench_tables [--max-entries=N] [--ops=N] [--filter=TABLE]
+//
+// Tables:
+//     unordered_map/std::hash       std::unordered_map<uint64_t, uint64_t>
+//     unordered_map/CompactHasher   same, hashed with compact_hash::CompactHasher
+//     KeyDir                        flat linear-probing table from kv_store.h (8-byte string keys)
+//     HashIndex                     mmap'ed index from hash_index.h (build + lookups only)
+//
+// Workloads (ns per operation): insert, lookup-hit, lookup-miss, erase.
+// Key distributions:
+//     uniform     random 64 bit keys, hits drawn uniformly from the stored keys
+//     sequential  keys base, base+1, ..., hits in insertion order
+//     zipfian     random keys, inserts and hits drawn with Zipf(0.99) skew
+// Table sizes default to 1 Ki, 16 Ki, 256 Ki and 4 Mi entries, i.e. roughly
+// L1, L2, last-level cache and DRAM resident for std::unordered_map nodes.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "compact_hasher.h"
+#include "hash_index.h"
+#include "kv_store.h"
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    template <class T>
+    inline void do_not_optimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    enum class Dist { Uniform, Sequential, Zipfian };
+    const char* dist_name(Dist d) {
+        return d == Dist::Uniform ? "uniform" : d == Dist::Sequential ? "sequential" : "zipfian";
+    }
+
+    // Pre-generated key streams, so generation cost stays out of the timings.
+    struct Workload {
+        std::vector<uint64_t> inserts;   // keys in insertion order (zipfian: with repeats)
+        std::vector<uint64_t> hits;      // keys present in the table
+        std::vector<uint64_t> misses;    // keys never inserted
+    };
+
+    // Zipf(s) ranks in [0, n) by inverse CDF; rank 0 is the most popular.
+    std::vector<uint32_t> zipf_ranks(size_t n, size_t count, double s, RNG::SplitMix64& gen) {
+        std::vector<double> cdf(n);
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) cdf[i] = (sum += 1.0 / std::pow(static_cast<double>(i + 1), s));
+        std::vector<double> u(count);
+        RNG::uniform_double(gen, u.data(), count, 0.0, sum);
+        std::vector<uint32_t> out(count);
+        for (size_t i = 0; i < count; ++i)
+            out[i] = static_cast<uint32_t>(std::lower_bound(cdf.begin(), cdf.end(), u[i]) - cdf.begin());
+        return out;
+    }
+
+    Workload make_workload(Dist dist, size_t n, size_t ops) {
+        RNG::SplitMix64 gen(n * 31 + static_cast<int>(dist));
+        Workload w;
+        std::vector<uint64_t> universe(n);
+        for (size_t i = 0; i < n; ++i)
+            universe[i] = dist == Dist::Sequential ? 1000000 + i : (gen() | 1);   // odd: present
+        for (size_t i = 0; i < ops; ++i)
+            w.misses.push_back(dist == Dist::Sequential ? 1000000 + n + i : (gen() & ~1ULL));  // even: absent
+
+        if (dist == Dist::Zipfian) {
+            for (uint32_t r : zipf_ranks(n, n, 0.99, gen)) w.inserts.push_back(universe[r]);
+            // hits must be present: draw ranks among the keys that were actually inserted
+            std::vector<uint64_t> present = w.inserts;
+            std::sort(present.begin(), present.end());
+            present.erase(std::unique(present.begin(), present.end()), present.end());
+            std::vector<uint64_t> by_rank;
+            for (uint64_t k : universe)
+                if (std::binary_search(present.begin(), present.end(), k)) by_rank.push_back(k);
+            for (uint32_t r : zipf_ranks(by_rank.size(), ops, 0.99, gen)) w.hits.push_back(by_rank[r]);
+        }
+        else {
+            w.inserts = universe;
+            std::vector<size_t> idx(ops);
+            if (dist == Dist::Sequential)
+                for (size_t i = 0; i < ops; ++i) idx[i] = i % n;
+            else
+                RNG::uniform_int(gen, idx.data(), ops, size_t(0), n - 1);
+            for (size_t i : idx) w.hits.push_back(universe[i]);
+        }
+        return w;
+    }
+
+    struct Timings {
+        double insert = 0, hit = 0, miss = 0, erase = 0;   // total seconds
+        size_t rounds = 0;
+    };
+
+    template <class F>
+    double time_it(F&& f) {
+        auto t0 = clock_type::now();
+        f();
+        return std::chrono::duration<double>(clock_type::now() - t0).count();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Table drivers
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    template <class Hash>
+    Timings run_unordered_map(const Workload& w, float load, size_t rounds) {
+        Timings t;
+        for (size_t r = 0; r < rounds; ++r, ++t.rounds) {
+            std::unordered_map<uint64_t, uint64_t, Hash> m;
+            m.max_load_factor(load);
+            m.reserve(w.inserts.size());
+            t.insert += time_it([&] { for (uint64_t k : w.inserts) m[k] = k; });
+            t.hit += time_it([&] {
+                uint64_t s = 0;
+                for (uint64_t k : w.hits) s += m.find(k)->second;
+                do_not_optimize(s);
+            });
+            t.miss += time_it([&] {
+                size_t s = 0;
+                for (uint64_t k : w.misses) s += m.count(k);
+                do_not_optimize(s);
+            });
+            t.erase += time_it([&] { for (uint64_t k : w.inserts) m.erase(k); });
+        }
+        return t;
+    }
+
+    std::vector<std::string> as_strings(const std::vector<uint64_t>& keys) {
+        std::vector<std::string> out;
+        out.reserve(keys.size());
+        for (uint64_t k : keys) out.emplace_back(reinterpret_cast<const char*>(&k), sizeof(k));
+        return out;
+    }
+
+    Timings run_keydir(const Workload& w, size_t rounds) {
+        std::vector<std::string> inserts = as_strings(w.inserts), hits = as_strings(w.hits), misses = as_strings(w.misses);
+        Timings t;
+        for (size_t r = 0; r < rounds; ++r, ++t.rounds) {
+            compact_hash::KeyDir d;
+            t.insert += time_it([&] { for (const std::string& k : inserts) d.upsert(k, 1, 8, 0); });
+            t.hit += time_it([&] {
+                uint64_t s = 0;
+                for (const std::string& k : hits) s += d.find(k)->value_size;
+                do_not_optimize(s);
+            });
+            t.miss += time_it([&] {
+                size_t s = 0;
+                for (const std::string& k : misses) s += d.find(k) != nullptr;
+                do_not_optimize(s);
+            });
+            t.erase += time_it([&] { for (const std::string& k : inserts) d.erase(k); });
+        }
+        return t;
+    }
+
+    // Insert time is the bulk build (hashing, placement and writing the file).
+    Timings run_hash_index(const Workload& w, double load, size_t rounds) {
+        const char* path = "bench_tables.idx";
+        Timings t;
+        for (size_t r = 0; r < rounds; ++r, ++t.rounds) {
+            compact_hash::HashIndex idx;
+            t.insert += time_it([&] {
+                compact_hash::HashIndexBuilder b;
+                b.reserve(w.inserts.size());
+                for (uint64_t k : w.inserts) b.add(reinterpret_cast<const uint8_t*>(&k), sizeof(k), k);
+                b.write(path, load);
+                idx.open(path);
+            });
+            t.hit += time_it([&] {
+                uint64_t s = 0, off = 0;
+                for (uint64_t k : w.hits) s += idx.find(reinterpret_cast<const uint8_t*>(&k), sizeof(k), off) + off;
+                do_not_optimize(s);
+            });
+            t.miss += time_it([&] {
+                uint64_t s = 0, off = 0;
+                for (uint64_t k : w.misses) s += idx.find(reinterpret_cast<const uint8_t*>(&k), sizeof(k), off);
+                do_not_optimize(s);
+            });
+            t.erase = -1;   // not supported
+        }
+        remove(path);
+        return t;
+    }
+
+    void report(const char* table, const char* load, Dist dist, size_t n, const Workload& w, const Timings& t) {
+        auto ns = [&](double total, size_t ops) { return total * 1e9 / (static_cast<double>(ops) * t.rounds); };
+        printf("%-30s %-6s %-11s %9zu %10.2f %10.2f %10.2f ", table, load, dist_name(dist), n,
+            ns(t.insert, w.inserts.size()), ns(t.hit, w.hits.size()), ns(t.miss, w.misses.size()));
+        if (t.erase < 0) printf("%10s\n", "-");
+        else printf("%10.2f\n", ns(t.erase, w.inserts.size()));
+        fflush(stdout);
+    }
+
+    bool parse_option(const char* arg, const char* name, const char*& value) {
+        size_t len = strlen(name);
+        if (strncmp(arg, name, len) != 0 || arg[len] != '=') return false;
+        value = arg + len + 1;
+        return true;
+    }
+
+}//namespace
+
+int main(int argc, char** argv) {
+    size_t max_entries = size_t(1) << 22;
+    size_t ops = size_t(1) << 20;
+    const char* filter = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        const char* v;
+        if (parse_option(argv[i], "--max-entries", v)) max_entries = static_cast<size_t>(strtoull(v, nullptr, 0));
+        else if (parse_option(argv[i], "--ops", v)) ops = static_cast<size_t>(strtoull(v, nullptr, 0));
+        else if (parse_option(argv[i], "--filter", v)) filter = v;
+        else {
+            fprintf(stderr, "usage: %s [--max-entries=N] [--ops=N] [--filter=TABLE]\n", argv[0]);
+            return 2;
+        }
+    }
+    auto want = [&](const char* table) { return !filter || strstr(table, filter); };
+
+    printf("%-30s %-6s %-11s %9s %10s %10s %10s %10s\n",
+        "table", "load", "keys", "entries", "insert", "hit", "miss", "erase");
+    const Dist dists[] = { Dist::Uniform, Dist::Sequential, Dist::Zipfian };
+    for (size_t n = 1024; n <= max_entries; n <<= 4) {
+        // small tables repeat so every configuration runs a comparable number of operations
+        size_t rounds = std::max<size_t>(1, (size_t(1) << 22) / n);
+        for (Dist dist : dists) {
+            Workload w = make_workload(dist, n, std::min(ops, n * 4));
+            for (float load : { 0.5f, 1.0f, 2.0f }) {
+                char lf[16];
+                snprintf(lf, sizeof(lf), "%.1f", load);
+                if (want("unordered_map/std::hash"))
+                    report("unordered_map/std::hash", lf, dist, n, w,
+                        run_unordered_map<std::hash<uint64_t>>(w, load, rounds));
+                if (want("unordered_map/CompactHasher"))
+                    report("unordered_map/CompactHasher", lf, dist, n, w,
+                        run_unordered_map<compact_hash::CompactHasher>(w, load, rounds));
+            }
+            if (want("KeyDir"))
+                report("KeyDir", "<=.75", dist, n, w, run_keydir(w, rounds));
+            for (double load : { 0.5, 0.8 }) {
+                char lf[16];
+                snprintf(lf, sizeof(lf), "%.1f", load);
+                if (want("HashIndex"))
+                    report("HashIndex", lf, dist, n, w, run_hash_index(w, load, rounds));
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,282 @@
+// File: benchmark.cpp
+// Description: Throughput and latency benchmark for compact_hash and reference hashes
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+//
+// Build (single translation unit, no dependencies):
+//     g++ -O3 -march=native -std=c++17 benchmark.cpp -o benchmark
+//     cl /O2 /std:c++17 /EHsc benchmark.cpp
+// If <xxhash.h> is on the include path, XXH3 is added to the comparison
+// (header-only, via XXH_INLINE_ALL).
+//
+// Usage:
+//     ./benchmark [--mode=throughput|latency|both] [--max-size=BYTES]
+//                 [--min-time=SECONDS] [--filter=NAME]
+//
+// For every input size from 0 B to --max-size (default 1 GiB) and every hash,
+// the benchmark repeats the call until --min-time has elapsed and reports GB/s.
+// For small keys (<= 128 bytes) it also reports ns/hash and cycles/hash; cycles
+// come from the time-stamp counter on x86 (reference cycles) and are omitted
+// elsewhere.
+//
+// Modes:
+//     throughput  independent calls; the CPU overlaps consecutive hashes
+//     latency     each call's key and seed depend on the previous result, as in a
+//                 chain of hash-table lookups, so the full critical path is timed
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>    // std::min
+#include <chrono>
+#include <functional>   // std::hash
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "compact_hash.h"
+
+#if defined(__has_include)
+#if __has_include(<xxhash.h>)
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+#define BENCH_HAVE_XXHASH 1
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>     // __rdtsc, _ReadWriteBarrier
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>  // __rdtsc
+#endif
+
+namespace {
+
+    // Keeps the compiler from hoisting or eliding a call whose inputs did not change.
+    template <class T>
+    inline void do_not_optimize(const T& value) {
+#if defined(_MSC_VER)
+        _ReadWriteBarrier();
+        (void)value;
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    inline uint64_t read_cycles() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    constexpr bool HAVE_CYCLES = true;
+#else
+    constexpr bool HAVE_CYCLES = false;
+#endif
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Candidates
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Local FNV-1a 64 reference (byte at a time).
+    uint64_t fnv1a64(const uint8_t* p, size_t n, uint64_t seed) {
+        uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+        for (size_t i = 0; i < n; ++i) {
+            h ^= p[i];
+            h *= 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+    uint64_t bench_compact_hash(const uint8_t* p, size_t n, uint64_t seed) {
+        return compact_hash::compact_hash(p, n, seed);
+    }
+
+    // Streaming path fed in fixed-size chunks, as a file or socket reader would.
+    uint64_t bench_streaming(const uint8_t* p, size_t n, uint64_t seed) {
+        constexpr size_t CHUNK = 4096;
+        compact_hash::CompactHash h(seed);
+        for (; n > CHUNK; n -= CHUNK, p += CHUNK)
+            h.insert(p, CHUNK);
+        h.insert(p, n);
+        return h.finalize();
+    }
+
+    uint64_t bench_extended(const uint8_t* p, size_t n, uint64_t seed) {
+        std::vector<uint64_t> words = compact_hash::compact_hash_extended(p, n, 4, seed);
+        return words[0] ^ words[1] ^ words[2] ^ words[3];
+    }
+
+    uint64_t bench_std_hash(const uint8_t* p, size_t n, uint64_t) {
+        return std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(p), n));
+    }
+
+#if defined(BENCH_HAVE_XXHASH)
+    uint64_t bench_xxh3(const uint8_t* p, size_t n, uint64_t seed) {
+        return XXH3_64bits_withSeed(p, n, seed);
+    }
+#endif
+
+    struct Candidate {
+        const char* name;
+        uint64_t (*fn)(const uint8_t*, size_t, uint64_t);
+    };
+
+    const Candidate CANDIDATES[] = {
+        { "compact_hash",          bench_compact_hash },
+        { "CompactHash(stream)",   bench_streaming },
+        { "compact_hash_extended4", bench_extended },
+        { "fnv1a64",               fnv1a64 },
+        { "std::hash",             bench_std_hash },
+#if defined(BENCH_HAVE_XXHASH)
+        { "XXH3_64bits",           bench_xxh3 },
+#endif
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Measurement
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    struct Result {
+        double seconds_per_hash;
+        double cycles_per_hash;
+    };
+
+    // Independent calls: the seed changes every iteration so no call can be hoisted,
+    // but no call waits for the previous result.
+    Result measure_throughput(const Candidate& c, const uint8_t* data, size_t size, double min_time) {
+        using clock = std::chrono::steady_clock;
+        uint64_t iters = 1;
+        for (;;) {
+            auto t0 = clock::now();
+            uint64_t c0 = read_cycles();
+            for (uint64_t i = 0; i < iters; ++i) {
+                do_not_optimize(data);
+                uint64_t h = c.fn(data, size, i);
+                do_not_optimize(h);
+            }
+            uint64_t c1 = read_cycles();
+            double elapsed = std::chrono::duration<double>(clock::now() - t0).count();
+            if (elapsed >= min_time || iters >= (1ULL << 40))
+                return { elapsed / iters, static_cast<double>(c1 - c0) / iters };
+            // aim past min_time on the next round, at least doubling
+            double scale = elapsed > 0 ? 1.5 * min_time / elapsed : 16.0;
+            iters = static_cast<uint64_t>(iters * (scale < 2.0 ? 2.0 : scale > 1000.0 ? 1000.0 : scale));
+        }
+    }
+
+    // Dependent chain: the previous hash is written into the first bytes of the key
+    // and used as the seed, so no call can start before the previous one finished.
+    // The store-to-load forward this adds is part of any real lookup chain too.
+    Result measure_latency(const Candidate& c, uint8_t* data, size_t size, double min_time) {
+        using clock = std::chrono::steady_clock;
+        size_t dep_bytes = size < 8 ? size : 8;
+        uint64_t iters = 1;
+        uint64_t h = 0;
+        for (;;) {
+            auto t0 = clock::now();
+            uint64_t c0 = read_cycles();
+            for (uint64_t i = 0; i < iters; ++i) {
+                memcpy(data, &h, dep_bytes);
+                h = c.fn(data, size, h);
+            }
+            uint64_t c1 = read_cycles();
+            double elapsed = std::chrono::duration<double>(clock::now() - t0).count();
+            do_not_optimize(h);
+            if (elapsed >= min_time || iters >= (1ULL << 40))
+                return { elapsed / iters, static_cast<double>(c1 - c0) / iters };
+            double scale = elapsed > 0 ? 1.5 * min_time / elapsed : 16.0;
+            iters = static_cast<uint64_t>(iters * (scale < 2.0 ? 2.0 : scale > 1000.0 ? 1000.0 : scale));
+        }
+    }
+
+    std::vector<size_t> benchmark_sizes(size_t max_size) {
+        std::vector<size_t> sizes = { 0, 1, 3, 4, 7, 8, 12, 16, 24, 32, 48, 64, 96, 128 };
+        for (size_t s = 256; s <= max_size && s != 0; s <<= 1)
+            sizes.push_back(s);
+        while (!sizes.empty() && sizes.back() > max_size)
+            sizes.pop_back();
+        return sizes;
+    }
+
+    std::string format_size(size_t n) {
+        char buf[32];
+        if (n >= (1u << 30) && n % (1u << 30) == 0) snprintf(buf, sizeof(buf), "%zu GiB", n >> 30);
+        else if (n >= (1u << 20) && n % (1u << 20) == 0) snprintf(buf, sizeof(buf), "%zu MiB", n >> 20);
+        else if (n >= (1u << 10) && n % (1u << 10) == 0) snprintf(buf, sizeof(buf), "%zu KiB", n >> 10);
+        else snprintf(buf, sizeof(buf), "%zu B", n);
+        return buf;
+    }
+
+    bool parse_option(const char* arg, const char* name, const char*& value) {
+        size_t len = strlen(name);
+        if (strncmp(arg, name, len) != 0 || arg[len] != '=') return false;
+        value = arg + len + 1;
+        return true;
+    }
+
+}//namespace
+
+int main(int argc, char** argv) {
+    size_t max_size = size_t(1) << 30;
+    double min_time = 0.2;
+    const char* filter = nullptr;
+    bool run_throughput = true;
+    bool run_latency = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* v;
+        if (parse_option(argv[i], "--mode", v)) {
+            run_throughput = !strcmp(v, "throughput") || !strcmp(v, "both");
+            run_latency = !strcmp(v, "latency") || !strcmp(v, "both");
+            if (!run_throughput && !run_latency) {
+                fprintf(stderr, "unknown mode '%s'\n", v);
+                return 2;
+            }
+        }
+        else if (parse_option(argv[i], "--max-size", v)) max_size = static_cast<size_t>(strtoull(v, nullptr, 0));
+        else if (parse_option(argv[i], "--min-time", v)) min_time = strtod(v, nullptr);
+        else if (parse_option(argv[i], "--filter", v)) filter = v;
+        else {
+            fprintf(stderr, "usage: %s [--mode=throughput|latency|both] [--max-size=BYTES] "
+                "[--min-time=SECONDS] [--filter=NAME]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Random, incompressible input shared by every measurement.
+    std::vector<uint8_t> data(max_size > 0 ? max_size : 1);
+    RNG::SplitMix64 gen(12345ULL);
+    uint64_t words[4096];
+    for (size_t i = 0; i + 8 <= data.size(); i += sizeof(words)) {
+        size_t n = std::min(sizeof(words), (data.size() - i) / 8 * 8);
+        gen.fill(words, n / 8);
+        memcpy(&data[i], words, n);
+    }
+
+    printf("%-24s %-10s %10s %10s %10s %12s\n", "hash", "mode", "size", "GB/s", "ns/hash", "cycles/hash");
+    for (const Candidate& c : CANDIDATES) {
+        if (filter && !strstr(c.name, filter)) continue;
+        for (size_t size : benchmark_sizes(max_size)) {
+            for (int latency = 0; latency < 2; ++latency) {
+                if (latency ? !run_latency : !run_throughput) continue;
+                Result r = latency
+                    ? measure_latency(c, data.data(), size, min_time)
+                    : measure_throughput(c, data.data(), size, min_time);
+                double gbps = size / r.seconds_per_hash / 1e9;
+                printf("%-24s %-10s %10s %10.2f", c.name, latency ? "latency" : "throughput",
+                    format_size(size).c_str(), gbps);
+                if (size <= 128) {
+                    printf(" %10.2f", r.seconds_per_hash * 1e9);
+                    if (HAVE_CYCLES) printf(" %12.1f", r.cycles_per_hash);
+                }
+                printf("\n");
+                fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
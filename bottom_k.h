@@ -0,0 +1,136 @@
+#pragma once
+// File: bottom_k.h
+// Description: Bottom-k sampling of unbounded streams with compact_hash priorities, mergeable across threads
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>          // uint64_t, uint8_t
+#include <cstddef>          // size_t
+#include <algorithm>        // std::push_heap, std::pop_heap, std::sort_heap
+#include <string_view>      // std::string_view
+#include <unordered_set>    // std::unordered_set of sampled priorities
+#include <utility>          // std::move
+#include <vector>           // std::vector heap storage
+
+#include "compact_hash.h"
+
+/*
+compact_hash::BottomKSampler - Uniform sample of k distinct keys from a stream
+
+Every item gets the priority compact_hash(key, seed); the sampler keeps the k items
+with the smallest priorities in a max-heap, so an offer that does not beat the
+current k-th priority costs one hash and one compare. Because priorities depend
+only on the key and the seed:
+    - the sample is deterministic: the same stream gives the same sample on every run
+    - samplers on different threads or nodes merge exactly: merging the per-shard
+      samples gives the sample of the combined stream
+    - a key offered many times is counted once (the sample is over distinct keys)
+Use the same seed everywhere samples are merged; the process_seed() default of the
+hash tables would break this, so the seed defaults to 0.
+
+Expected work for n distinct keys is n hashes plus O(k log(n/k)) heap updates.
+
+distinct_estimate() is the bottom-k estimate of the number of distinct keys seen,
+(k - 1) / (k-th priority / 2^64), with a relative error of about 1/sqrt(k - 2).
+
+API:
+    BottomKSampler<T> s(k, seed = 0);
+    bool kept = s.offer(key, size, item);        // or offer(std::string_view, item)
+    bool kept = s.offer_priority(priority, item);
+    s.merge(other);
+    std::vector<BottomKSampler<T>::Entry> v = s.sample();   // ascending priority
+    double n = s.distinct_estimate();
+
+Usage example:
+
+    // one sampler per worker thread, merged at the end
+    std::vector<compact_hash::BottomKSampler<Event>> local(threads, compact_hash::BottomKSampler<Event>(1000));
+    ... local[t].offer(event.trace_id, event);
+    for (size_t t = 1; t < threads; ++t) local[0].merge(local[t]);
+    auto sample = local[0].sample();
+*/
+
+namespace compact_hash {
+
+    template <class T>
+    class BottomKSampler {
+    public:
+        struct Entry {
+            uint64_t priority;
+            T item;
+        };
+
+        explicit BottomKSampler(size_t k, uint64_t seed = 0) : k(k), seed(seed) {
+            heap.reserve(k);
+        }
+
+        // Offer an item under its key. Returns true if it entered the sample.
+        bool offer(const uint8_t* key, size_t size, const T& item) {
+            return offer_priority(compact_hash(key, size, seed), item);
+        }
+
+        bool offer(std::string_view key, const T& item) {
+            return offer(reinterpret_cast<const uint8_t*>(key.data()), key.size(), item);
+        }
+
+        // Offer with a precomputed priority, e.g. compact_hash_words() of an integer id.
+        bool offer_priority(uint64_t priority, const T& item) {
+            if (k == 0) return false;
+            if (heap.size() == k && priority >= heap.front().priority) return false;
+            if (!members.insert(priority).second) return false;     // key already sampled
+            if (heap.size() == k) {
+                std::pop_heap(heap.begin(), heap.end(), Less());
+                members.erase(heap.back().priority);
+                heap.pop_back();
+            }
+            heap.push_back(Entry{ priority, item });
+            std::push_heap(heap.begin(), heap.end(), Less());
+            return true;
+        }
+
+        // Fold another sampler (same k and seed) into this one.
+        void merge(const BottomKSampler& other) {
+            for (const Entry& e : other.heap) offer_priority(e.priority, e.item);
+        }
+
+        // The sample in ascending priority order.
+        std::vector<Entry> sample() const {
+            std::vector<Entry> out = heap;
+            std::sort_heap(out.begin(), out.end(), Less());
+            return out;
+        }
+
+        size_t size() const noexcept { return heap.size(); }
+        size_t capacity() const noexcept { return k; }
+
+        // Largest priority in a full sample: offers at or above it are rejected.
+        uint64_t threshold() const noexcept { return heap.size() == k && k ? heap.front().priority : UINT64_MAX; }
+
+        // Estimated number of distinct keys offered. Exact while the sample is not full.
+        double distinct_estimate() const noexcept {
+            if (heap.size() < k || k < 2) return static_cast<double>(heap.size());
+            double kth = (static_cast<double>(heap.front().priority) + 1.0) * (1.0 / 18446744073709551616.0);
+            return static_cast<double>(k - 1) / kth;
+        }
+
+        void clear() {
+            heap.clear();
+            members.clear();
+        }
+
+    private:
+        struct Less {
+            bool operator()(const Entry& a, const Entry& b) const noexcept { return a.priority < b.priority; }
+        };
+
+        // Priorities are already uniform hashes.
+        struct Identity {
+            size_t operator()(uint64_t p) const noexcept { return static_cast<size_t>(p); }
+        };
+
+        size_t k;
+        uint64_t seed;
+        std::vector<Entry> heap;                        // max-heap on priority
+        std::unordered_set<uint64_t, Identity> members; // priorities in heap, for distinct keys
+    };//class BottomKSampler
+
+}//namespace compact_hash
@@ -32,10 +32,21 @@ API:
     // One-shot convenience function
     uint64_t compact_hash(const uint8_t* data, size_t size, uint64_t seed = 0);
 
+    // Integer fast path: hash two 64 bit words without building a byte buffer.
+    uint64_t compact_hash_words(uint64_t m0, uint64_t m1, uint64_t seed = 0);
+
     // Extended output: produce multiple 64 bit words from a single input.
     std::vector<uint64_t> compact_hash_extended(
         const uint8_t* data, size_t size, size_t nWords, uint64_t seed = 0)l
 
+    // 32 bit output: both halves of the 64 bit digest folded together.
+    uint32_t compact_hash32(const uint8_t* data, size_t size, uint64_t seed = 0);
+
+    // Table indexing without a division (uses the well-mixed high bits):
+    uint64_t fastrange64(uint64_t hash, uint64_t n);        // [0, n)
+    uint32_t fastrange32(uint32_t hash, uint32_t n);        // [0, n)
+    uint64_t fastrange_pow2(uint64_t hash, unsigned bits);  // [0, 2^bits)
+
 Usage examples:
 
     // Example 1 (streaming):
@@ -117,6 +128,14 @@ _umul128 on MSVC x64/ARM64 or __uint128_t on GCC/Clang"
             }
         }
 
+        // Integer fast path: equivalent to insert() of the 16 bytes holding m0 and m1 in native
+        // byte order, without staging the words through a byte buffer.
+        inline void insert_words(uint64_t m0, uint64_t m1) noexcept {
+            total_len += 16;
+            state[0] = compress(state[0], m0);
+            state[1] = compress(state[1], m1);
+        }
+
         // finalize(), based on xxh3 finalization
         inline uint64_t finalize() noexcept {
             uint64_t h = compress(state[0], state[1]);
@@ -151,6 +170,43 @@ _umul128 on MSVC x64/ARM64 or __uint128_t on GCC/Clang"
         return h.finalize();
     }//compact_hash
 
+    // One-shot integer fast path: same digest as compact_hash() over the 16 bytes of m0 and m1.
+    inline uint64_t compact_hash_words(uint64_t m0, uint64_t m1, uint64_t seed = 0) noexcept {
+        CompactHash h(seed);
+        h.insert_words(m0, m1);
+        return h.finalize();
+    }//compact_hash_words
+
+    // 32 bit digest for tables that store 32 bit hashes. Folding keeps every input bit
+    // (both 64 bit halves) in the result instead of truncating to the low word.
+    inline uint32_t fold32(uint64_t hash) noexcept {
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    inline uint32_t compact_hash32(const uint8_t* data, size_t size, uint64_t seed = 0) noexcept {
+        return fold32(compact_hash(data, size, seed));
+    }//compact_hash32
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Range reduction: map a hash onto table indices with a multiply or shift instead of %.
+
+    // Map hash uniformly onto [0, n): the high word of hash * n (Lemire's fastrange).
+    // One multiply instead of a 64 bit division; any n, including non powers of two.
+    inline uint64_t fastrange64(uint64_t hash, uint64_t n) noexcept {
+        uint64_t hi;
+        _umul128(hash, n, &hi);
+        return hi;
+    }
+
+    inline uint32_t fastrange32(uint32_t hash, uint32_t n) noexcept {
+        return static_cast<uint32_t>((static_cast<uint64_t>(hash) * n) >> 32);
+    }
+
+    // Index into a table of 2^bits slots (bits <= 64) from the top bits of hash.
+    inline uint64_t fastrange_pow2(uint64_t hash, unsigned bits) noexcept {
+        return bits == 0 ? 0 : hash >> (64 - bits);
+    }
+
     // Extended output: produce multiple 64 bit words from a single input.
     // Uses SplitMix64 to generate high-quality independent seeds for each word.
     std::vector<uint64_t> compact_hash_extended(
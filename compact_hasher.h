@@ -0,0 +1,132 @@
+#pragma once
+// File: compact_hasher.h
+// Description: std::hash-compatible adapter for unordered containers, built on compact_hash
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t
+#include <cstddef>      // size_t
+#include <cstring>      // memcpy
+#include <initializer_list> // std::initializer_list of element words
+#include <string>       // std::string
+#include <string_view>  // std::string_view
+#include <tuple>        // std::tuple, std::apply
+#include <type_traits>  // std::is_integral, std::is_floating_point, std::has_unique_object_representations
+#include <utility>      // std::pair
+
+#include "compact_hash.h"
+#include "process_seed.h"
+
+/*
+compact_hash::CompactHasher - Drop-in Hash for std::unordered_map / unordered_set
+
+Strings are hashed by content. Integers, enums and pointers take the integer fast
+path (CompactHash::insert_words), and so do float and double, as the bits of the
+double value with -0.0 folded into 0.0 (equal keys, equal hashes). Other trivially
+copyable types without padding are hashed by their object representation.
+std::pair and std::tuple are hashed structurally: each element becomes one word
+(integers as they are, anything else through this hasher, recursively), and the
+words go in two per insert_words(), so padding inside a tuple never reaches the
+hash. The seeded state is computed once per hasher, so a call costs the
+compression and finalize only. Without a seed the hasher uses process_seed(), so
+iteration order and collisions differ per process.
+
+API:
+    CompactHasher h(seed = process_seed());
+    size_t v = h(key);                                   // also std::pair, std::tuple keys
+
+Usage example:
+
+    std::unordered_map<std::string, int, compact_hash::CompactHasher> m;
+    std::unordered_map<uint64_t, int, compact_hash::CompactHasher> ids(
+        0, compact_hash::CompactHasher(12345ULL));
+*/
+
+namespace compact_hash {
+
+    class CompactHasher {
+    public:
+        explicit CompactHasher(uint64_t seed = process_seed()) noexcept : seeded(seed) {}
+
+        size_t operator()(std::string_view s) const noexcept {
+            return bytes(s.data(), s.size());
+        }
+        size_t operator()(const std::string& s) const noexcept {
+            return bytes(s.data(), s.size());
+        }
+        size_t operator()(const char* s) const noexcept {
+            return (*this)(std::string_view(s));
+        }
+
+        template <class A, class B>
+        size_t operator()(const std::pair<A, B>& key) const noexcept {
+            return combine({ element(key.first), element(key.second) });
+        }
+
+        template <class... Ts>
+        size_t operator()(const std::tuple<Ts...>& key) const noexcept {
+            return std::apply([this](const Ts&... xs) { return combine({ element(xs)... }); }, key);
+        }
+
+        template <class T>
+        size_t operator()(const T& key) const noexcept {
+            if constexpr (is_word<T>()) {
+                CompactHash h = seeded;
+                h.insert_words(word(key), 0);
+                return static_cast<size_t>(h.finalize());
+            }
+            else {
+                static_assert(std::has_unique_object_representations<T>::value,
+                    "CompactHasher: key type must be a string, an integer, or trivially copyable without padding");
+                return bytes(&key, sizeof(T));
+            }
+        }
+
+    private:
+        // Types hashed as a single 64 bit word. long double is excluded: its padding bytes are unspecified.
+        template <class T>
+        static constexpr bool is_word() noexcept {
+            return std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value ||
+                std::is_same<T, float>::value || std::is_same<T, double>::value;
+        }
+
+        template <class T>
+        static uint64_t word(const T& key) noexcept {
+            if constexpr (std::is_pointer<T>::value) return reinterpret_cast<uintptr_t>(key);
+            else if constexpr (std::is_floating_point<T>::value) {
+                double d = key == 0 ? 0.0 : static_cast<double>(key);    // -0.0 == 0.0
+                uint64_t bits;
+                memcpy(&bits, &d, sizeof(bits));
+                return bits;
+            }
+            else return static_cast<uint64_t>(key);
+        }
+
+        // One word per element of a pair or tuple; C strings by content, not address.
+        template <class T>
+        uint64_t element(const T& x) const noexcept {
+            if constexpr (std::is_same<T, const char*>::value || std::is_same<T, char*>::value)
+                return (*this)(std::string_view(x));
+            else if constexpr (is_word<T>())
+                return word(x);
+            else return (*this)(x);
+        }
+
+        size_t combine(std::initializer_list<uint64_t> words) const noexcept {
+            CompactHash h = seeded;
+            const uint64_t* w = words.begin();
+            size_t i = 0;
+            for (; i + 1 < words.size(); i += 2) h.insert_words(w[i], w[i + 1]);
+            if (i < words.size()) h.insert_words(w[i], 0);
+            return static_cast<size_t>(h.finalize());
+        }
+
+        size_t bytes(const void* p, size_t n) const noexcept {
+            CompactHash h = seeded;
+            h.insert(static_cast<const uint8_t*>(p), n);
+            return static_cast<size_t>(h.finalize());
+        }
+
+        CompactHash seeded;
+    };//class CompactHasher
+
+}//namespace compact_hash
@@ -0,0 +1,159 @@
+#pragma once
+// File: feature_hashing.h
+// Description: Feature hashing (the hashing trick) of namespaced tokens into CSR sparse rows
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t, uint32_t, uint8_t
+#include <cstddef>      // size_t
+#include <algorithm>    // std::sort
+#include <string_view>  // std::string_view
+#include <vector>       // std::vector
+
+#include "compact_hash.h"
+
+/*
+compact_hash::FeatureHasher - Map (namespace, token) features to a fixed-dimension sparse vector
+
+Each namespace is hashed once into a seed; a token's hash under that seed picks
+its column with fastrange64 (high bits) and, in the signed variant, its sign from
+the lowest bit. Signs make colliding features cancel in expectation instead of
+adding up, so inner products stay unbiased (Weinberger et al., 2009).
+
+Hashing is deterministic for a given seed: training and serving must use the same
+seed and dimension, so the seed defaults to 0 rather than process_seed().
+
+HashedCsr collects rows directly in CSR form (indptr, indices, values). Within a
+row, duplicate columns are summed, columns are sorted, and entries that cancel to
+exactly zero are dropped, as scipy / scikit-learn expect.
+
+API:
+    FeatureHasher fh(dimension, seed = 0, FeatureHasher::SIGNED);   // dimension 0 becomes 1
+    uint64_t ns = fh.namespace_seed("title");
+    fh.hash_tokens(ns, tokens, n, columns, signs);   // batch, signs may be nullptr
+
+    HashedCsr csr(fh);
+    csr.add(ns, tokens, n);                          // optional weights[n]
+    csr.end_row();
+    const std::vector<size_t>& indptr = csr.indptr;  // indices, values likewise
+
+Usage example:
+
+    compact_hash::FeatureHasher fh(1 << 20);
+    compact_hash::HashedCsr csr(fh);
+    uint64_t title = fh.namespace_seed("title"), body = fh.namespace_seed("body");
+    for (const Doc& d : docs) {
+        csr.add(title, d.title_tokens.data(), d.title_tokens.size());
+        csr.add(body, d.body_tokens.data(), d.body_tokens.size());
+        csr.end_row();
+    }
+*/
+
+namespace compact_hash {
+
+    class FeatureHasher {
+    public:
+        enum Sign { UNSIGNED, SIGNED };
+
+        // dimension 0 is clamped to 1, so column() < dimension() always holds.
+        explicit FeatureHasher(uint32_t dimension, uint64_t seed = 0, Sign sign = SIGNED) noexcept
+            : dim(dimension ? dimension : 1), seed(seed), sign(sign) {}
+
+        // Seed for all tokens of a namespace; compute once per namespace, not per token.
+        uint64_t namespace_seed(std::string_view ns) const noexcept {
+            return compact_hash(reinterpret_cast<const uint8_t*>(ns.data()), ns.size(), seed);
+        }
+
+        // Column and sign (+1 / -1, or +1 when unsigned) of one token.
+        inline uint32_t column(uint64_t token_hash) const noexcept {
+            return static_cast<uint32_t>(fastrange64(token_hash, dim));
+        }
+        inline float sign_of(uint64_t token_hash) const noexcept {
+            return sign == SIGNED && (token_hash & 1) ? -1.0f : 1.0f;
+        }
+
+        // Hash n tokens of one namespace. The seeded state is built once for the batch.
+        void hash_tokens(uint64_t ns_seed, const std::string_view* tokens, size_t n,
+            uint32_t* columns, float* signs) const noexcept
+        {
+            const CompactHash seeded(ns_seed);
+            for (size_t i = 0; i < n; ++i) {
+                CompactHash h = seeded;
+                h.insert(reinterpret_cast<const uint8_t*>(tokens[i].data()), tokens[i].size());
+                uint64_t v = h.finalize();
+                columns[i] = column(v);
+                if (signs) signs[i] = sign_of(v);
+            }
+        }
+
+        uint32_t dimension() const noexcept { return dim; }
+
+    private:
+        uint32_t dim;
+        uint64_t seed;
+        Sign sign;
+    };//class FeatureHasher
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Rows of hashed features in CSR form, appended one row at a time. Keeps a reference
+    // to the hasher, which must outlive it.
+    class HashedCsr {
+    public:
+        explicit HashedCsr(const FeatureHasher& hasher) : hasher(hasher), indptr(1, 0) {}
+
+        // Add n tokens of one namespace to the current row, each with weight 1 or weights[i].
+        void add(uint64_t ns_seed, const std::string_view* tokens, size_t n, const float* weights = nullptr) {
+            size_t start = pending.size();
+            pending.resize(start + n);
+            cols.resize(n);
+            vals.resize(n);
+            hasher.hash_tokens(ns_seed, tokens, n, cols.data(), vals.data());
+            for (size_t i = 0; i < n; ++i)
+                pending[start + i] = Entry{ cols[i], weights ? vals[i] * weights[i] : vals[i] };
+        }
+
+        // Close the current row: sort by column, sum duplicates, drop exact zeros.
+        void end_row() {
+            std::sort(pending.begin(), pending.end(),
+                [](const Entry& a, const Entry& b) { return a.column < b.column; });
+            for (size_t i = 0; i < pending.size();) {
+                uint32_t c = pending[i].column;
+                float v = 0;
+                for (; i < pending.size() && pending[i].column == c; ++i) v += pending[i].value;
+                if (v != 0.0f) {
+                    indices.push_back(c);
+                    values.push_back(v);
+                }
+            }
+            indptr.push_back(indices.size());
+            pending.clear();
+        }
+
+        size_t rows() const noexcept { return indptr.size() - 1; }
+        uint32_t dimension() const noexcept { return hasher.dimension(); }
+
+        void clear() {
+            indptr.assign(1, 0);
+            indices.clear();
+            values.clear();
+            pending.clear();
+        }
+
+    private:
+        struct Entry {
+            uint32_t column;
+            float value;
+        };
+
+        const FeatureHasher& hasher;
+        std::vector<Entry> pending;     // current row, before end_row()
+        std::vector<uint32_t> cols;     // hash_tokens scratch
+        std::vector<float> vals;
+
+    public:
+        std::vector<size_t> indptr;     // row r spans [indptr[r], indptr[r + 1])
+        std::vector<uint32_t> indices;  // column of each stored entry
+        std::vector<float> values;      // value of each stored entry
+    };//class HashedCsr
+
+}//namespace compact_hash
@@ -0,0 +1,90 @@
+#pragma once
+// File: flow_hash.h
+// Description: Symmetric 5-tuple flow hashing for packet steering, built on compact_hash
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t, uint32_t, uint16_t, uint8_t
+#include <cstddef>      // size_t
+
+#include "compact_hash.h"
+#include "process_seed.h"
+
+/*
+compact_hash::FlowHasher - Symmetric 5-tuple flow hash
+
+Both directions of a connection hash to the same value, so a packet and its reply
+are steered to the same worker. The tuple is packed straight into two 64 bit words
+and fed through CompactHash::insert_words(), so no byte buffer is built per packet.
+
+Canonical form:
+    Each endpoint is packed as (ip << 16 | port). The smaller endpoint goes into the
+    low 48 bits of word 0 together with the protocol in bits 48..55, the larger
+    endpoint into word 1. Swapping source and destination yields the same words.
+
+FlowHasher defaults to process_seed(), so crafted tuples cannot pile flows onto one
+worker. Processes that must agree on steering pass the same explicit seed.
+
+API:
+    FlowHasher fh(seed = process_seed());
+    uint64_t h = fh(key);
+    fh.hash_batch(keys, n, out);
+
+    // One-shot convenience function
+    uint64_t flow_hash(const FlowKey& key, uint64_t seed = 0);
+
+Usage example:
+
+    compact_hash::FlowHasher fh(12345ULL);
+    compact_hash::FlowKey key{ src_ip, dst_ip, src_port, dst_port, 6 };
+    uint64_t h = fh(key);   // fh(reversed key) == h
+*/
+
+namespace compact_hash {
+
+    // IPv4 5-tuple. Addresses and ports may be in either byte order, as long as
+    // the same order is used for both directions.
+    struct FlowKey {
+        uint32_t src_ip;
+        uint32_t dst_ip;
+        uint16_t src_port;
+        uint16_t dst_port;
+        uint8_t  proto;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    class FlowHasher {
+    public:
+        // The seeded state is computed once; per-packet hashing only copies it.
+        explicit FlowHasher(uint64_t seed = process_seed()) noexcept : seeded(seed) {}
+
+        inline uint64_t operator()(const FlowKey& key) const noexcept {
+            uint64_t a = (static_cast<uint64_t>(key.src_ip) << 16) | key.src_port;
+            uint64_t b = (static_cast<uint64_t>(key.dst_ip) << 16) | key.dst_port;
+            uint64_t lo = a < b ? a : b;   // branchless min/max (cmov)
+            uint64_t hi = a < b ? b : a;
+
+            CompactHash h = seeded;
+            h.insert_words(lo | (static_cast<uint64_t>(key.proto) << 48), hi);
+            return h.finalize();
+        }
+
+        // Batch version for packet vectors. Iterations are independent, so the
+        // multiplies of consecutive packets overlap in the pipeline.
+        inline void hash_batch(const FlowKey* keys, size_t n, uint64_t* out) const noexcept {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = (*this)(keys[i]);
+        }
+
+    private:
+        CompactHash seeded;
+    };//class FlowHasher
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // One-shot convenience function
+    inline uint64_t flow_hash(const FlowKey& key, uint64_t seed = 0) noexcept {
+        return FlowHasher(seed)(key);
+    }//flow_hash
+
+}//namespace compact_hash
@@ -0,0 +1,232 @@
+#pragma once
+// File: hash_cons.h
+// Description: Hash-consing of immutable DAG nodes into canonical, arena-allocated instances
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>          // uint64_t, uint32_t, uintptr_t
+#include <cstddef>          // size_t, max_align_t
+#include <cstring>          // memcpy, memcmp for floating-point payloads
+#include <initializer_list> // std::initializer_list children
+#include <memory>           // std::unique_ptr arena blocks
+#include <new>              // placement new
+#include <type_traits>      // std::is_trivially_destructible
+#include <vector>           // std::vector
+
+#include "compact_hash.h"
+#include "compact_hasher.h" // CompactHasher for node payloads
+#include "process_seed.h"
+
+/*
+compact_hash::HashConsTable - One canonical instance per structurally equal node
+
+A node is a tag, a payload value and an ordered list of child nodes. make() returns
+the existing node when an equal one (same tag, equal value, identical children)
+was made before, and otherwise creates it. Because children are themselves
+canonical, two nodes are structurally equal exactly when their pointers are equal:
+equality of whole subtrees is one pointer compare, and shared subtrees are stored
+once.
+
+Node hash: CompactHash over (tag, arity, value) and the children's stored hashes,
+two per insert_words(); non-integer values enter as their CompactHasher hash.
+Each node's hash is computed once, at creation, so make() costs O(arity)
+whatever the depth of the subtree.
+
+A float or double payload is compared and hashed by its bits, not with ==: -0.0
+and 0.0 stay distinct nodes (1/x must not change sign), and equal NaNs share one
+node. long double is rejected because its padding bytes are unspecified. Floating
+point inside a pair or tuple payload still goes through == and CompactHasher.
+
+Nodes and their child arrays live contiguously in an Arena of 64 KiB blocks and
+stay valid (and at the same address) until clear() or destruction of the table.
+The index is a flat open-addressing table of (hash, node) like KeyDir, with
+linear probing and max load 0.75. The payload type T must be equality-comparable
+and hashable by CompactHasher (strings, numbers, pairs and tuples of those,
+padding-free trivially copyable types). The table is not thread-safe.
+
+API:
+    Arena a;                                            // bump allocator on its own
+    void* p = a.allocate(size, align);
+    HashConsTable<T> t(seed = process_seed());
+    const Node* n = t.make(tag, value, children, arity);  // or make(tag, value, {c0, c1, ...})
+    n->tag, n->value, n->arity, n->child(i), n->hash
+    size_t nodes = t.size(), bytes = t.bytes();
+
+Usage example:
+
+    compact_hash::HashConsTable<int64_t> dag;
+    using Node = compact_hash::HashConsTable<int64_t>::Node;
+    const Node* x = dag.make(VAR, 0);
+    const Node* one = dag.make(CONST, 1);
+    const Node* a = dag.make(ADD, 0, { x, one });
+    const Node* b = dag.make(ADD, 0, { x, dag.make(CONST, 1) });
+    assert(a == b);                                     // same node, stored once
+*/
+
+namespace compact_hash {
+
+    // Bump allocator: carves allocations out of 64 KiB blocks and frees them all at once.
+    class Arena {
+    public:
+        static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // Uninitialized storage of `size` bytes; align must be a power of two <= alignof(std::max_align_t).
+        void* allocate(size_t size, size_t align) {
+            uintptr_t p = (cursor + align - 1) & ~static_cast<uintptr_t>(align - 1);
+            if (blocks.empty() || p + size > limit) {
+                size_t block = size + align > BLOCK_SIZE ? size + align : BLOCK_SIZE;
+                blocks.emplace_back(new std::max_align_t[(block + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)]);
+                cursor = reinterpret_cast<uintptr_t>(blocks.back().get());
+                limit = cursor + block;
+                p = (cursor + align - 1) & ~static_cast<uintptr_t>(align - 1);
+            }
+            cursor = p + size;
+            used += size;
+            return reinterpret_cast<void*>(p);
+        }
+
+        // Bytes handed out by allocate() since the last clear().
+        size_t bytes_used() const noexcept { return used; }
+
+        void clear() noexcept {
+            blocks.clear();
+            cursor = limit = 0;
+            used = 0;
+        }
+
+    private:
+        std::vector<std::unique_ptr<std::max_align_t[]>> blocks;
+        uintptr_t cursor = 0;   // next free byte of the current block
+        uintptr_t limit = 0;    // end of the current block
+        size_t used = 0;
+    };//class Arena
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    template <class T>
+    class HashConsTable {
+    public:
+        struct Node {
+            uint64_t hash;          // never 0
+            uint32_t tag;
+            uint32_t arity;
+            T value;
+
+            // The child array follows the node in the arena.
+            const Node* const* children() const noexcept { return reinterpret_cast<const Node* const*>(this + 1); }
+            const Node* child(size_t i) const noexcept { return children()[i]; }
+        };
+
+        static_assert(alignof(Node) <= alignof(std::max_align_t), "HashConsTable: over-aligned payload types are not supported");
+        static_assert(!std::is_same<T, long double>::value, "HashConsTable: long double payloads have no well-defined bit identity");
+
+        explicit HashConsTable(uint64_t seed = process_seed()) : seeded(seed), value_hasher(seed), slots(16) {}
+        ~HashConsTable() { clear(); }
+        HashConsTable(const HashConsTable&) = delete;
+        HashConsTable& operator=(const HashConsTable&) = delete;
+
+        // The canonical node for (tag, value, children[0 .. arity)). Children must be nodes of this table.
+        const Node* make(uint32_t tag, const T& value, const Node* const* children = nullptr, size_t arity = 0) {
+            const uint64_t h = hash_node(tag, value, children, arity);
+            size_t i = h & mask();
+            for (; slots[i].hash != 0; i = (i + 1) & mask())
+                if (slots[i].hash == h && equal(slots[i].node, tag, value, children, arity)) return slots[i].node;
+
+            if ((count + 1) * 4 > slots.size() * 3) {   // max load 0.75
+                grow();
+                for (i = h & mask(); slots[i].hash != 0; i = (i + 1) & mask()) {}
+            }
+            void* p = arena.allocate(sizeof(Node) + arity * sizeof(const Node*), alignof(Node));
+            Node* n = new (p) Node{ h, tag, static_cast<uint32_t>(arity), value };
+            const Node** kids = reinterpret_cast<const Node**>(n + 1);
+            for (size_t k = 0; k < arity; ++k) kids[k] = children[k];
+            slots[i] = Slot{ h, n };
+            ++count;
+            return n;
+        }
+
+        const Node* make(uint32_t tag, const T& value, std::initializer_list<const Node*> children) {
+            return make(tag, value, children.begin(), children.size());
+        }
+
+        // Number of distinct nodes, and arena bytes they occupy.
+        size_t size() const noexcept { return count; }
+        size_t bytes() const noexcept { return arena.bytes_used(); }
+
+        // Destroy every node; pointers returned by make() become invalid.
+        void clear() noexcept {
+            if constexpr (!std::is_trivially_destructible<T>::value) {
+                for (Slot& s : slots)
+                    if (s.hash != 0) s.node->~Node();
+            }
+            slots.assign(16, Slot{});
+            count = 0;
+            arena.clear();
+        }
+
+    private:
+        struct Slot {
+            uint64_t hash = 0;      // 0 = empty
+            Node* node = nullptr;
+        };
+
+        size_t mask() const noexcept { return slots.size() - 1; }
+
+        uint64_t hash_node(uint32_t tag, const T& value, const Node* const* children, size_t arity) const noexcept {
+            CompactHash h = seeded;
+            h.insert_words(tag | (static_cast<uint64_t>(arity) << 32), value_word(value));
+            size_t k = 0;
+            for (; k + 1 < arity; k += 2) h.insert_words(children[k]->hash, children[k + 1]->hash);
+            if (k < arity) h.insert_words(children[k]->hash, 0);
+            uint64_t v = h.finalize();
+            return v | (v == 0);
+        }
+
+        // Integers and enums go in as they are, float and double as their raw bits;
+        // other payloads through CompactHasher.
+        uint64_t value_word(const T& value) const noexcept {
+            if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) return static_cast<uint64_t>(value);
+            else if constexpr (std::is_floating_point<T>::value) {
+                uint64_t bits = 0;
+                memcpy(&bits, &value, sizeof(T));
+                return bits;
+            }
+            else return value_hasher(value);
+        }
+
+        // Bit identity for floating point (-0.0 != 0.0, NaN == same NaN), == otherwise.
+        static bool same_value(const T& a, const T& b) {
+            if constexpr (std::is_floating_point<T>::value) return memcmp(&a, &b, sizeof(T)) == 0;
+            else return a == b;
+        }
+
+        static bool equal(const Node* n, uint32_t tag, const T& value, const Node* const* children, size_t arity) {
+            if (n->tag != tag || n->arity != arity || !same_value(n->value, value)) return false;
+            const Node* const* kids = n->children();
+            for (size_t k = 0; k < arity; ++k)
+                if (kids[k] != children[k]) return false;
+            return true;
+        }
+
+        void grow() {
+            std::vector<Slot> old(slots.size() * 2);
+            old.swap(slots);
+            for (const Slot& s : old) {
+                if (s.hash == 0) continue;
+                size_t i = s.hash & mask();
+                while (slots[i].hash != 0) i = (i + 1) & mask();
+                slots[i] = s;
+            }
+        }
+
+        CompactHash seeded;
+        CompactHasher value_hasher;
+        std::vector<Slot> slots;    // power-of-two size
+        size_t count = 0;
+        Arena arena;
+    };//class HashConsTable
+
+}//namespace compact_hash
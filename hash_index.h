@@ -0,0 +1,305 @@
+#pragma once
+// File: hash_index.h
+// Description: Memory-mapped persistent open-addressing index keyed by compact_hash tags
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t, uint32_t
+#include <cstddef>      // size_t
+#include <cstdio>       // rename
+#include <string>       // temporary file and directory names
+#include <utility>      // std::swap
+#include <vector>       // std::vector for the bulk builder
+
+#if defined(_WIN32)
+#error "hash_index.h requires POSIX mmap (Linux, macOS, BSD)"
+#endif
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap, munmap, msync
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // close, ftruncate, fsync, unlink
+
+#include "compact_hash.h"
+#include "process_seed.h"
+
+/*
+compact_hash::HashIndex - On-disk hash index that opens instantly via mmap
+
+The file is a fixed 64 byte header followed by a power-of-two array of 16 byte
+slots. Each slot holds a 64 bit compact_hash tag of the key and a 64 bit offset
+(typically the position of the record in a separate data file). Opening maps the
+file; nothing is read or rebuilt, pages are faulted in on first lookup.
+
+File layout (native byte order; a foreign-endian file fails the magic check):
+    HashIndexHeader   magic, version, seed, slot_count, entry_count
+    HashIndexSlot[]   { tag, offset }, tag == 0 marks an empty slot
+
+Lookups compare tags only. With 64 bit tags a false match is rare but possible,
+so callers should verify the key stored at the returned offset; for_each_match()
+visits every slot with the same tag.
+
+API:
+    HashIndexBuilder b(seed = process_seed());     // seed is stored in the file
+    b.add(key, size, offset);
+    bool ok = b.write(path, max_load = 0.5);      // via path.tmp and rename
+
+    HashIndex idx;
+    bool ok = idx.open(path, writable = false);
+    bool found = idx.find(key, size, offset);
+    bool ok = idx.insert(key, size, offset);     // append, needs writable
+
+Usage example:
+
+    compact_hash::HashIndexBuilder builder(12345ULL);
+    builder.add(reinterpret_cast<const uint8_t*>(key), key_len, record_offset);
+    builder.write("keys.idx");
+
+    compact_hash::HashIndex idx;
+    idx.open("keys.idx");
+    uint64_t offset;
+    if (idx.find(reinterpret_cast<const uint8_t*>(key), key_len, offset)) { ... }
+*/
+
+namespace compact_hash {
+
+    struct HashIndexHeader {
+        static constexpr uint64_t MAGIC = 0x31584449484d4f43ULL;  // "COMHIDX1" read little-endian
+        static constexpr uint32_t VERSION = 1;
+
+        uint64_t magic;
+        uint32_t version;
+        uint32_t header_size;     // sizeof(HashIndexHeader), slots start here
+        uint64_t seed;            // compact_hash seed used for all tags
+        uint64_t slot_count;      // power of two
+        uint64_t entry_count;     // occupied slots
+        uint64_t reserved[3];
+    };
+    static_assert(sizeof(HashIndexHeader) == 64, "HashIndexHeader must stay 64 bytes");
+
+    struct HashIndexSlot {
+        uint64_t tag;             // compact_hash of the key, 0 = empty
+        uint64_t offset;
+    };
+    static_assert(sizeof(HashIndexSlot) == 16, "HashIndexSlot must stay 16 bytes");
+
+    // Tag for a key. Zero is reserved for empty slots and remapped to one.
+    inline uint64_t hash_index_tag(const uint8_t* key, size_t size, uint64_t seed) noexcept {
+        uint64_t tag = compact_hash(key, size, seed);
+        return tag | (tag == 0);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    class HashIndex {
+    public:
+        static constexpr double MAX_APPEND_LOAD = 0.8;   // insert() refuses beyond this
+
+        HashIndex() noexcept = default;
+        ~HashIndex() { close(); }
+        HashIndex(const HashIndex&) = delete;
+        HashIndex& operator=(const HashIndex&) = delete;
+        HashIndex(HashIndex&& o) noexcept { swap(o); }
+        HashIndex& operator=(HashIndex&& o) noexcept { close(); swap(o); return *this; }
+
+        // Map an existing index file. Returns false if the file is missing,
+        // truncated, not an index of this version, or has no empty slot left.
+        bool open(const char* path, bool writable = false) noexcept {
+            close();
+            fd = ::open(path, writable ? O_RDWR : O_RDONLY);
+            if (fd < 0) return false;
+
+            struct stat st;
+            if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(HashIndexHeader)) {
+                close();
+                return false;
+            }
+            map_size = static_cast<size_t>(st.st_size);
+            void* p = mmap(nullptr, map_size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                map_size = 0;
+                close();
+                return false;
+            }
+            header = static_cast<HashIndexHeader*>(p);
+
+            uint64_t n = header->slot_count;
+            if (header->magic != HashIndexHeader::MAGIC || header->version != HashIndexHeader::VERSION ||
+                header->header_size != sizeof(HashIndexHeader) || n == 0 || (n & (n - 1)) != 0 ||
+                (map_size - sizeof(HashIndexHeader)) / sizeof(HashIndexSlot) < n ||
+                header->entry_count >= n) {                 // probes end only at an empty slot
+                close();
+                return false;
+            }
+            slots = reinterpret_cast<HashIndexSlot*>(static_cast<uint8_t*>(p) + header->header_size);
+            mask = n - 1;
+            is_writable = writable;
+            return true;
+        }
+
+        void close() noexcept {
+            if (header) munmap(header, map_size);
+            if (fd >= 0) ::close(fd);
+            header = nullptr;
+            slots = nullptr;
+            fd = -1;
+            map_size = 0;
+            mask = 0;
+            is_writable = false;
+        }
+
+        bool is_open() const noexcept { return header != nullptr; }
+        // 0 when no index is open.
+        uint64_t seed() const noexcept { return header ? header->seed : 0; }
+        uint64_t size() const noexcept { return header ? header->entry_count : 0; }
+        uint64_t capacity() const noexcept { return header ? header->slot_count : 0; }
+
+        // First slot whose tag matches the key. Returns false if absent.
+        bool find(const uint8_t* key, size_t size, uint64_t& offset) const noexcept {
+            bool found = false;
+            for_each_match(key, size, [&](uint64_t off) { offset = off; found = true; return false; });
+            return found;
+        }
+
+        // Calls f(offset) for every slot whose tag matches the key, in probe order,
+        // until f returns false. Use this when the caller verifies keys itself.
+        // At most capacity() slots are probed, even if a corrupt file has no empty slot.
+        template <class F>
+        void for_each_match(const uint8_t* key, size_t size, F&& f) const {
+            if (!header) return;
+            uint64_t tag = hash_index_tag(key, size, header->seed);
+            for (uint64_t i = tag & mask, left = mask + 1; left != 0; i = (i + 1) & mask, --left) {
+                const HashIndexSlot& s = slots[i];
+                if (s.tag == 0) return;
+                if (s.tag == tag && !f(s.offset)) return;
+            }
+        }
+
+        // Append a key in place. Returns false if the index is read-only or would
+        // exceed MAX_APPEND_LOAD; rebuild with a larger builder in that case.
+        // Also returns false if a corrupt file has no empty slot on the probe path.
+        // Duplicate keys are stored as separate entries.
+        bool insert(const uint8_t* key, size_t size, uint64_t offset) noexcept {
+            if (!is_writable) return false;
+            if (static_cast<double>(header->entry_count + 1) > MAX_APPEND_LOAD * header->slot_count)
+                return false;
+            if (!place(slots, mask, hash_index_tag(key, size, header->seed), offset))
+                return false;
+            ++header->entry_count;
+            return true;
+        }
+
+        // Flush dirty pages of a writable index to disk.
+        bool sync() noexcept {
+            return header && msync(header, map_size, MS_SYNC) == 0;
+        }
+
+        // Linear-probe placement shared with HashIndexBuilder. Probes at most
+        // mask + 1 slots; returns false if none of them is empty.
+        static bool place(HashIndexSlot* slots, uint64_t mask, uint64_t tag, uint64_t offset) noexcept {
+            for (uint64_t i = tag & mask, left = mask + 1; left != 0; i = (i + 1) & mask, --left) {
+                if (slots[i].tag != 0) continue;
+                slots[i].tag = tag;
+                slots[i].offset = offset;
+                return true;
+            }
+            return false;
+        }
+
+    private:
+        void swap(HashIndex& o) noexcept {
+            std::swap(fd, o.fd);
+            std::swap(map_size, o.map_size);
+            std::swap(header, o.header);
+            std::swap(slots, o.slots);
+            std::swap(mask, o.mask);
+            std::swap(is_writable, o.is_writable);
+        }
+
+        int fd = -1;
+        size_t map_size = 0;
+        HashIndexHeader* header = nullptr;
+        HashIndexSlot* slots = nullptr;
+        uint64_t mask = 0;
+        bool is_writable = false;
+    };//class HashIndex
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Bulk builder: collects tags in memory, then writes the whole file in one pass.
+    class HashIndexBuilder {
+    public:
+        explicit HashIndexBuilder(uint64_t seed = process_seed()) noexcept : seed(seed) {}
+
+        void reserve(size_t n) { entries.reserve(n); }
+
+        void add(const uint8_t* key, size_t size, uint64_t offset) {
+            entries.push_back({ hash_index_tag(key, size, seed), offset });
+        }
+
+        size_t size() const noexcept { return entries.size(); }
+
+        // Write the index. Slot count is the smallest power of two keeping the load at
+        // or below max_load for the current entries plus extra_capacity future appends.
+        // The file is built as path.tmp, synced and renamed over path, so readers that
+        // have the old index mapped keep it intact and a crash never leaves it truncated.
+        // The directory is synced after the rename, so a true return survives a crash.
+        bool write(const char* path, double max_load = 0.5, size_t extra_capacity = 0) const {
+            if (!(max_load > 0.0 && max_load <= HashIndex::MAX_APPEND_LOAD)) return false;
+            uint64_t want = static_cast<uint64_t>((entries.size() + extra_capacity) / max_load) + 1;
+            uint64_t n = 16;
+            while (n < want) n <<= 1;
+
+            size_t bytes = sizeof(HashIndexHeader) + n * sizeof(HashIndexSlot);
+            const std::string tmp = std::string(path) + ".tmp";
+            int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) return false;
+            void* p = MAP_FAILED;
+            if (ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+                p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                unlink(tmp.c_str());
+                return false;
+            }
+
+            // ftruncate zero-fills, so every slot starts empty
+            HashIndexHeader* header = static_cast<HashIndexHeader*>(p);
+            HashIndexSlot* slots = reinterpret_cast<HashIndexSlot*>(header + 1);
+            for (const HashIndexSlot& e : entries)
+                HashIndex::place(slots, n - 1, e.tag, e.offset);
+
+            *header = HashIndexHeader{};
+            header->version = HashIndexHeader::VERSION;
+            header->header_size = sizeof(HashIndexHeader);
+            header->seed = seed;
+            header->slot_count = n;
+            header->entry_count = entries.size();
+            header->magic = HashIndexHeader::MAGIC;   // written last: a crashed build fails open()
+
+            bool ok = msync(p, bytes, MS_SYNC) == 0;
+            munmap(p, bytes);
+            ok = fsync(fd) == 0 && ok;
+            ok = ::close(fd) == 0 && ok;
+            ok = ok && rename(tmp.c_str(), path) == 0;
+            if (!ok) unlink(tmp.c_str());
+            return ok && sync_directory(path);
+        }
+
+    private:
+        // fsync the directory holding path, making a rename into it durable.
+        static bool sync_directory(const char* path) {
+            std::string dir(path);
+            const size_t slash = dir.rfind('/');
+            dir = slash == std::string::npos ? "." : slash == 0 ? "/" : dir.substr(0, slash);
+            int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+            if (fd < 0) return false;
+            bool ok = fsync(fd) == 0;
+            ::close(fd);
+            return ok;
+        }
+
+        uint64_t seed;
+        std::vector<HashIndexSlot> entries;
+    };//class HashIndexBuilder
+
+}//namespace compact_hash
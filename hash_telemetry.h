@@ -0,0 +1,259 @@
+#pragma once
+// File: hash_telemetry.h
+// Description: Opt-in per call-site input-size histograms for compact_hash callers
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t
+#include <cstddef>      // size_t
+#include <cstdio>       // FILE, fprintf, snprintf
+#include <atomic>       // std::atomic
+#include <mutex>        // std::mutex
+#include <string>       // std::string
+#include <vector>       // std::vector
+
+/*
+compact_hash::telemetry - How many bytes do our call-sites actually hash?
+
+COMPACT_HASH_TELEMETRY_RECORD("site", size) counts one hash of `size` bytes for the
+named site in a log2 histogram: bucket 0 holds size 0, bucket b >= 1 holds sizes in
+[2^(b-1), 2^b). The totals tell which fast paths and kernel tiers matter.
+
+Cost and concurrency:
+    - COMPACT_HASH_TELEMETRY not defined: the macro expands to nothing.
+    - Defined: each thread owns its counters, so recording is a thread-local array
+      index plus three relaxed load/store pairs; no locks or shared cache lines.
+      The only lock is taken once per thread and once per site for registration.
+    - Snapshots (text or JSON) may be taken at any time from any thread. Counts of
+      threads that have exited are folded into a global total.
+
+At most MAX_SITES distinct sites are tracked (define COMPACT_HASH_TELEMETRY_MAX_SITES
+to change it); further sites are ignored.
+
+API:
+    COMPACT_HASH_TELEMETRY_RECORD("site name", size);
+    void telemetry::write_text(FILE* out = stdout);
+    std::string telemetry::to_json();
+
+Usage example:
+
+    #define COMPACT_HASH_TELEMETRY
+    #include "hash_telemetry.h"
+
+    uint64_t lookup_hash(const std::string& key) {
+        COMPACT_HASH_TELEMETRY_RECORD("session lookup", key.size());
+        return compact_hash::compact_hash(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+    }
+    ...
+    compact_hash::telemetry::write_text(stderr);
+*/
+
+#ifndef COMPACT_HASH_TELEMETRY_MAX_SITES
+#define COMPACT_HASH_TELEMETRY_MAX_SITES 256
+#endif
+
+namespace compact_hash {
+namespace telemetry {
+
+    constexpr size_t MAX_SITES = COMPACT_HASH_TELEMETRY_MAX_SITES;
+    constexpr int NUM_BUCKETS = 65;     // 0, then one per bit length of size
+
+    // Bit length of size: 0 for 0, else floor(log2(size)) + 1.
+    inline int bucket_of(uint64_t size) noexcept {
+#if defined(__GNUC__)
+        return size ? 64 - __builtin_clzll(size) : 0;
+#else
+        int b = 0;
+        while (size) { ++b; size >>= 1; }
+        return b;
+#endif
+    }
+
+    // Smallest size counted in bucket b.
+    inline uint64_t bucket_lower(int b) noexcept { return b == 0 ? 0 : 1ULL << (b - 1); }
+
+    // Counters of one site in one thread. Written only by the owning thread;
+    // atomics make concurrent snapshot reads well defined.
+    struct SiteCounters {
+        std::atomic<uint64_t> calls{ 0 };
+        std::atomic<uint64_t> bytes{ 0 };
+        std::atomic<uint64_t> buckets[NUM_BUCKETS] = {};
+
+        static void bump(std::atomic<uint64_t>& c, uint64_t by) noexcept {
+            c.store(c.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+        }
+    };
+
+    struct Totals {
+        uint64_t calls = 0;
+        uint64_t bytes = 0;
+        uint64_t buckets[NUM_BUCKETS] = {};
+
+        void add(const SiteCounters& c) noexcept {
+            calls += c.calls.load(std::memory_order_relaxed);
+            bytes += c.bytes.load(std::memory_order_relaxed);
+            for (int b = 0; b < NUM_BUCKETS; ++b) buckets[b] += c.buckets[b].load(std::memory_order_relaxed);
+        }
+    };
+
+    class ThreadSlab;
+
+    // Process-wide registry: site names, live thread slabs, totals of exited threads.
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::string> names;
+        std::vector<ThreadSlab*> slabs;
+        std::vector<Totals> retired = std::vector<Totals>(MAX_SITES);
+
+        static Registry& get() { static Registry r; return r; }
+    };
+
+    class ThreadSlab {
+    public:
+        static ThreadSlab& local() {
+            thread_local ThreadSlab slab;
+            return slab;
+        }
+
+        inline void record(size_t site, uint64_t size) {
+            SiteCounters* c = sites[site].load(std::memory_order_relaxed);
+            if (!c) c = create(site);
+            SiteCounters::bump(c->calls, 1);
+            SiteCounters::bump(c->bytes, size);
+            SiteCounters::bump(c->buckets[bucket_of(size)], 1);
+        }
+
+        void add_to(size_t site, Totals& t) const {
+            if (const SiteCounters* c = sites[site].load(std::memory_order_acquire)) t.add(*c);
+        }
+
+    private:
+        ThreadSlab() {
+            Registry& r = Registry::get();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.slabs.push_back(this);
+        }
+
+        ~ThreadSlab() {
+            Registry& r = Registry::get();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for (size_t i = 0; i < MAX_SITES; ++i) add_to(i, r.retired[i]);
+            for (size_t i = 0; i < r.slabs.size(); ++i)
+                if (r.slabs[i] == this) { r.slabs.erase(r.slabs.begin() + i); break; }
+            for (auto& s : sites) delete s.load(std::memory_order_relaxed);
+        }
+
+        SiteCounters* create(size_t site) {
+            SiteCounters* c = new SiteCounters();
+            sites[site].store(c, std::memory_order_release);   // publish to snapshot readers
+            return c;
+        }
+
+        std::atomic<SiteCounters*> sites[MAX_SITES] = {};
+    };//class ThreadSlab
+
+    // A named call-site. Declared static at the call-site by the macro.
+    class Site {
+    public:
+        explicit Site(const char* name) {
+            Registry& r = Registry::get();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            id = r.names.size();
+            if (id < MAX_SITES) r.names.push_back(name);
+        }
+
+        inline void record(uint64_t size) {
+            if (id < MAX_SITES) ThreadSlab::local().record(id, size);
+        }
+
+    private:
+        size_t id;
+    };//class Site
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Snapshots
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    struct SiteSnapshot {
+        std::string name;
+        Totals totals;
+    };
+
+    inline std::vector<SiteSnapshot> snapshot() {
+        Registry& r = Registry::get();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::vector<SiteSnapshot> out(r.names.size());
+        for (size_t i = 0; i < r.names.size(); ++i) {
+            out[i].name = r.names[i];
+            out[i].totals = r.retired[i];
+            for (const ThreadSlab* s : r.slabs) s->add_to(i, out[i].totals);
+        }
+        return out;
+    }
+
+    inline void write_text(FILE* out = stdout) {
+        for (const SiteSnapshot& s : snapshot()) {
+            const Totals& t = s.totals;
+            fprintf(out, "%s: %llu calls, %llu bytes, mean %.1f bytes\n", s.name.c_str(),
+                static_cast<unsigned long long>(t.calls), static_cast<unsigned long long>(t.bytes),
+                t.calls ? static_cast<double>(t.bytes) / t.calls : 0.0);
+            for (int b = 0; b < NUM_BUCKETS; ++b) {
+                if (!t.buckets[b]) continue;
+                uint64_t lo = bucket_lower(b), hi = b == 0 ? 0 : (lo << 1) - 1;
+                fprintf(out, "    %10llu .. %-10llu %12llu  %5.1f%%\n",
+                    static_cast<unsigned long long>(lo), static_cast<unsigned long long>(hi),
+                    static_cast<unsigned long long>(t.buckets[b]), 100.0 * t.buckets[b] / t.calls);
+            }
+        }
+    }
+
+    // {"sites":[{"name":"...","calls":N,"bytes":N,"histogram":[{"min":0,"max":0,"count":N},...]}]}
+    // Only non-empty buckets are listed.
+    inline std::string to_json() {
+        std::string j = "{\"sites\":[";
+        bool first_site = true;
+        for (const SiteSnapshot& s : snapshot()) {
+            if (!first_site) j += ',';
+            first_site = false;
+            j += "{\"name\":\"";
+            for (char c : s.name) {
+                if (c == '"' || c == '\\') { j += '\\'; j += c; }
+                else if (static_cast<unsigned char>(c) < 0x20) {
+                    char esc[8];
+                    snprintf(esc, sizeof(esc), "\\u%04x", c);
+                    j += esc;
+                }
+                else j += c;
+            }
+            j += "\",\"calls\":" + std::to_string(s.totals.calls);
+            j += ",\"bytes\":" + std::to_string(s.totals.bytes);
+            j += ",\"histogram\":[";
+            bool first_bucket = true;
+            for (int b = 0; b < NUM_BUCKETS; ++b) {
+                if (!s.totals.buckets[b]) continue;
+                if (!first_bucket) j += ',';
+                first_bucket = false;
+                uint64_t lo = bucket_lower(b), hi = b == 0 ? 0 : (lo << 1) - 1;
+                j += "{\"min\":" + std::to_string(lo) + ",\"max\":" + std::to_string(hi) +
+                     ",\"count\":" + std::to_string(s.totals.buckets[b]) + "}";
+            }
+            j += "]}";
+        }
+        j += "]}";
+        return j;
+    }
+
+}//namespace telemetry
+}//namespace compact_hash
+
+#define COMPACT_HASH_TELEMETRY_CONCAT_(a, b) a##b
+#define COMPACT_HASH_TELEMETRY_CONCAT(a, b) COMPACT_HASH_TELEMETRY_CONCAT_(a, b)
+
+#if defined(COMPACT_HASH_TELEMETRY)
+#define COMPACT_HASH_TELEMETRY_RECORD(name, size)                                                          \
+    do {                                                                                                   \
+        static ::compact_hash::telemetry::Site COMPACT_HASH_TELEMETRY_CONCAT(compact_hash_tm_site_, __LINE__){ name }; \
+        COMPACT_HASH_TELEMETRY_CONCAT(compact_hash_tm_site_, __LINE__).record(size);                      \
+    } while (0)
+#else
+#define COMPACT_HASH_TELEMETRY_RECORD(name, size) ((void)0)
+#endif
@@ -0,0 +1,154 @@
+#pragma once
+// File: kmer_hash.h
+// Description: Rolling canonical k-mer hashes and window minimizers for 2-bit encoded DNA
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t, uint8_t
+#include <cstddef>      // size_t
+#include <vector>       // std::vector ring buffer of the minimizer deque
+
+#include "mix64.h"      // mix64, the invertible integer mixer
+
+/*
+compact_hash::KmerHasher - Strand-independent k-mer hashes in O(1) per base
+
+Bases are 2-bit codes A=0, C=1, G=2, T=3 (encode_dna() converts ASCII); any code
+above 3 (N and other ambiguity symbols) ends the current run, and k-mers never
+span it. For k <= 32 the k-mer and its reverse complement are both kept as 2k-bit
+integers and updated per base with a shift and an or, so no k-mer is re-read.
+The canonical k-mer is the smaller of the two, and its hash is
+mix64(canonical ^ seed): a bijection, so distinct k-mers never collide.
+
+Minimizers: for every window of w consecutive k-mers, the k-mer with the smallest
+hash (leftmost on ties). A monotone deque of candidates makes this O(1) amortized
+per base; each minimizer is reported once, when it first becomes the window's
+minimum. The (w, k) minimizers of both strands of a sequence are the same set.
+
+API:
+    size_t encode_dna(const char* ascii, size_t n, uint8_t* codes);
+    KmerHasher h(k, seed = 0);                         // 1 <= k <= 32, else !h.valid()
+    h.for_each(codes, n, f);                           // f(pos, hash) for every k-mer
+    h.minimizers(codes, n, w, f);                      // f(pos, hash) for each minimizer
+pos is the index of the k-mer's first base.
+
+Usage example:
+
+    std::vector<uint8_t> codes(read.size());
+    compact_hash::encode_dna(read.data(), read.size(), codes.data());
+    compact_hash::KmerHasher kh(21);
+    kh.minimizers(codes.data(), codes.size(), 11, [&](size_t pos, uint64_t hash) {
+        index.add(hash, read_id, pos);
+    });
+*/
+
+namespace compact_hash {
+
+    // ASCII to 2-bit codes: A/C/G/T (either case) to 0..3, everything else to 4.
+    // Returns the number of ambiguous bases.
+    inline size_t encode_dna(const char* ascii, size_t n, uint8_t* codes) noexcept {
+        static const struct Table {
+            uint8_t code[256];
+            Table() noexcept {
+                for (uint8_t& c : code) c = 4;
+                code['A'] = code['a'] = 0;
+                code['C'] = code['c'] = 1;
+                code['G'] = code['g'] = 2;
+                code['T'] = code['t'] = 3;
+            }
+        } table;
+        size_t ambiguous = 0;
+        for (size_t i = 0; i < n; ++i) {
+            codes[i] = table.code[static_cast<unsigned char>(ascii[i])];
+            ambiguous += codes[i] > 3;
+        }
+        return ambiguous;
+    }
+
+    class KmerHasher {
+    public:
+        // k outside 1..32 is rejected: the hasher is !valid() and reports no k-mers.
+        explicit KmerHasher(unsigned k, uint64_t seed = 0) noexcept
+            : k(k >= 1 && k <= 32 ? k : 0), seed(seed),
+              mask(this->k == 32 ? ~0ULL : (1ULL << (2 * this->k)) - 1),
+              top_shift(this->k ? 2 * (this->k - 1) : 0) {}
+
+        bool valid() const noexcept { return k != 0; }
+        unsigned size() const noexcept { return k; }
+
+        // Hash of a canonical (or any) k-mer packed as 2k bits, first base highest.
+        inline uint64_t hash(uint64_t kmer) const noexcept { return mix64(kmer ^ seed); }
+
+        // f(pos, hash) for every k-mer free of ambiguous bases, in order.
+        template <class F>
+        void for_each(const uint8_t* codes, size_t n, F&& f) const {
+            if (!valid()) return;
+            uint64_t fwd = 0, rev = 0;
+            unsigned run = 0;       // valid bases since the last ambiguous one
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t c = codes[i];
+                if (c > 3) { run = 0; continue; }
+                fwd = ((fwd << 2) | c) & mask;
+                rev = (rev >> 2) | ((3 - c) << top_shift);
+                if (++run >= k) {
+                    run = k;
+                    f(i + 1 - k, hash(fwd < rev ? fwd : rev));
+                }
+            }
+        }
+
+        // f(pos, hash) for each (w, k) minimizer, once per distinct position, in order.
+        // A run shorter than w + k - 1 bases has no complete window and reports nothing.
+        // The rolling loop is repeated here rather than built on for_each(): with the
+        // deque state in locals instead of lambda captures the compiler keeps it in
+        // registers (captured size_t counters may alias Candidate::pos).
+        template <class F>
+        void minimizers(const uint8_t* codes, size_t n, unsigned w, F&& f) const {
+            if (w == 0 || !valid()) return;
+            size_t cap = 1;
+            while (cap < static_cast<size_t>(w) + 1) cap <<= 1;
+            std::vector<Candidate> buffer(cap);
+            Candidate* ring = buffer.data();
+            const size_t ring_mask = cap - 1;
+            size_t head = 0, tail = 0;          // deque is ring[head .. tail), hashes increasing
+            size_t last_pos = SIZE_MAX;         // last reported minimizer
+            uint64_t fwd = 0, rev = 0;
+            size_t run = 0;                     // valid bases since the last ambiguous one
+
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t c = codes[i];
+                if (c > 3) {
+                    run = 0;
+                    head = tail = 0;
+                    continue;
+                }
+                fwd = ((fwd << 2) | c) & mask;
+                rev = (rev >> 2) | ((3 - c) << top_shift);
+                if (++run < k) continue;
+                const size_t pos = i + 1 - k;
+                const uint64_t h = hash(fwd < rev ? fwd : rev);
+                while (tail != head && ring[(tail - 1) & ring_mask].hash > h) --tail;
+                ring[tail++ & ring_mask] = Candidate{ pos, h };
+                while (ring[head & ring_mask].pos + w <= pos) ++head;
+                if (run >= static_cast<size_t>(k) + w - 1) {     // the run holds a full window
+                    const Candidate m = ring[head & ring_mask];
+                    if (m.pos != last_pos) {
+                        last_pos = m.pos;
+                        f(m.pos, m.hash);
+                    }
+                }
+            }
+        }
+
+    private:
+        struct Candidate {
+            size_t pos;
+            uint64_t hash;
+        };
+
+        unsigned k;
+        uint64_t seed;
+        uint64_t mask;          // low 2k bits
+        unsigned top_shift;     // bit position of the first base of a k-mer
+    };//class KmerHasher
+
+}//namespace compact_hash
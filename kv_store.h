@@ -0,0 +1,577 @@
+#pragma once
+// File: kv_store.h
+// Description: Bitcask-style log-structured key-value store with an in-memory compact_hash keydir
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t, uint32_t
+#include <cstddef>      // size_t
+#include <cstdio>       // snprintf, FILE, rename
+#include <algorithm>    // std::sort, std::all_of
+#include <charconv>     // std::from_chars for file ids
+#include <string>       // std::string
+#include <vector>       // std::vector
+#include <map>          // std::map of open data files
+#include <mutex>        // std::mutex
+#include <shared_mutex> // std::shared_mutex, readers share the keydir
+#include <thread>       // std::thread for background compaction
+#include <atomic>       // std::atomic<bool>
+#include <filesystem>   // directory listing
+#include <utility>      // std::swap
+
+#if defined(_WIN32)
+#error "kv_store.h requires POSIX file I/O (Linux, macOS, BSD)"
+#endif
+#include <fcntl.h>      // open
+#include <sys/stat.h>   // fstat
+#include <sys/uio.h>    // writev
+#include <unistd.h>     // pread, close, fsync, ftruncate, unlink
+
+#include "compact_hash.h"
+#include "process_seed.h"
+
+/*
+compact_hash::KvStore - Small embedded Bitcask-style key-value store
+
+Writes append to the active data file; reads take one pread() at the offset held
+in the in-memory keydir. The keydir is a flat open-addressing table keyed by the
+compact_hash of the key, so a lookup is one hash plus (usually) one cache line.
+The keydir is rebuilt on open and never persisted, so it hashes with
+process_seed() and stored keys cannot be chosen to collide.
+
+On disk (directory of numbered files):
+    NNNNNNNNN.data   records: { check, key_size, value_size } key value
+                     value_size == TOMBSTONE marks a delete
+    NNNNNNNNN.hint   written by compaction next to each merged data file:
+                     { key_size, value_size, value_offset } key
+Startup replays files in id order, reading the small hint file instead of the
+data file whenever one exists and all its entries lie within the data file.
+
+Compaction copies the live records of every immutable file into one merged file
+(plus its hint file) and deletes the originals. It runs on a background thread
+while reads and writes continue; entries overwritten during the copy keep their
+newer location. Both files are written as *.tmp, fsynced, renamed data first,
+then hint, and the directory fsynced before any original is deleted, so a crash
+at any point leaves either the old files or a complete merged file. Leftover
+*.tmp files are removed by open().
+
+API:
+    KvStore db;
+    bool ok = db.open(dir, options);
+    bool ok = db.put(key, value);
+    bool found = db.get(key, value);
+    bool ok = db.del(key);
+    bool ok = db.compact();                 // synchronous
+    bool started = db.compact_async();      // background thread
+    bool ok = db.last_compaction_ok();      // result of the last finished compaction
+
+Usage example:
+
+    compact_hash::KvStore db;
+    db.open("/var/lib/mystore");
+    db.put("user:42", "{...}");
+    std::string v;
+    if (db.get("user:42", v)) { ... }
+*/
+
+namespace compact_hash {
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // KeyDir: flat open-addressing table from key to on-disk value location
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    struct KeyDirEntry {
+        uint64_t hash = 0;          // compact_hash of key, 0 = empty slot
+        uint32_t file_id = 0;
+        uint32_t value_size = 0;
+        uint64_t value_offset = 0;
+        std::string key;
+    };
+
+    class KeyDir {
+    public:
+        explicit KeyDir(uint64_t seed = process_seed()) : seed(seed), slots(16) {}
+
+        size_t size() const noexcept { return count; }
+        size_t capacity() const noexcept { return slots.size(); }
+
+        const KeyDirEntry* find(const std::string& key) const noexcept {
+            uint64_t h = hash_key(key);
+            for (size_t i = h & mask(); slots[i].hash != 0; i = (i + 1) & mask())
+                if (slots[i].hash == h && slots[i].key == key) return &slots[i];
+            return nullptr;
+        }
+
+        // Insert or overwrite the location of key.
+        void upsert(const std::string& key, uint32_t file_id, uint32_t value_size, uint64_t value_offset) {
+            if ((count + 1) * 4 > slots.size() * 3) grow();   // max load 0.75
+            uint64_t h = hash_key(key);
+            size_t i = h & mask();
+            for (; slots[i].hash != 0; i = (i + 1) & mask())
+                if (slots[i].hash == h && slots[i].key == key) break;
+            KeyDirEntry& e = slots[i];
+            if (e.hash == 0) {
+                e.hash = h;
+                e.key = key;
+                ++count;
+            }
+            e.file_id = file_id;
+            e.value_size = value_size;
+            e.value_offset = value_offset;
+        }
+
+        // Remove key. Uses backward-shift deletion, so no tombstones accumulate.
+        bool erase(const std::string& key) noexcept {
+            uint64_t h = hash_key(key);
+            size_t i = h & mask();
+            for (; slots[i].hash != 0; i = (i + 1) & mask())
+                if (slots[i].hash == h && slots[i].key == key) break;
+            if (slots[i].hash == 0) return false;
+
+            for (size_t j = (i + 1) & mask(); slots[j].hash != 0; j = (j + 1) & mask()) {
+                size_t home = slots[j].hash & mask();
+                // move j back into the hole at i unless its home lies cyclically in (i, j]
+                if (((j - home) & mask()) >= ((j - i) & mask())) {
+                    std::swap(slots[i], slots[j]);
+                    i = j;
+                }
+            }
+            slots[i] = KeyDirEntry{};
+            --count;
+            return true;
+        }
+
+        template <class F>
+        void for_each(F&& f) const {
+            for (const KeyDirEntry& e : slots)
+                if (e.hash != 0) f(e);
+        }
+
+    private:
+        size_t mask() const noexcept { return slots.size() - 1; }
+
+        uint64_t hash_key(const std::string& key) const noexcept {
+            uint64_t h = compact_hash(reinterpret_cast<const uint8_t*>(key.data()), key.size(), seed);
+            return h | (h == 0);
+        }
+
+        void grow() {
+            std::vector<KeyDirEntry> old(slots.size() * 2);
+            old.swap(slots);
+            for (KeyDirEntry& e : old) {
+                if (e.hash == 0) continue;
+                size_t i = e.hash & mask();
+                while (slots[i].hash != 0) i = (i + 1) & mask();
+                slots[i] = std::move(e);
+            }
+        }
+
+        uint64_t seed;
+        std::vector<KeyDirEntry> slots;   // power-of-two size
+        size_t count = 0;
+    };//class KeyDir
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // KvStore
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    struct KvStoreOptions {
+        uint64_t max_file_size = 256ULL << 20;  // roll the active file past this size
+        bool sync_writes = false;               // fsync after every put/del
+    };
+
+    class KvStore {
+    public:
+        static constexpr uint32_t TOMBSTONE = 0xffffffffu;
+
+        struct RecordHeader {
+            uint64_t check;         // record_check(key, value), detects torn or corrupt records
+            uint32_t key_size;
+            uint32_t value_size;
+        };
+        struct HintHeader {
+            uint32_t key_size;
+            uint32_t value_size;
+            uint64_t value_offset;
+        };
+
+        KvStore() = default;
+        ~KvStore() { close(); }
+        KvStore(const KvStore&) = delete;
+        KvStore& operator=(const KvStore&) = delete;
+
+        // Open or create a store in dir and rebuild the keydir from hint/data files.
+        bool open(const std::string& dir, const KvStoreOptions& opts = KvStoreOptions()) {
+            close();
+            std::error_code ec;
+            std::filesystem::create_directories(dir, ec);
+            if (ec) return false;
+            path = dir;
+            options = opts;
+
+            std::vector<uint32_t> ids;
+            for (const auto& de : std::filesystem::directory_iterator(dir, ec)) {
+                const std::filesystem::path& p = de.path();
+                if (p.extension() == ".tmp") {          // unfinished compaction output
+                    std::filesystem::remove(p, ec);
+                    continue;
+                }
+                std::string stem = p.stem().string();
+                if (p.extension() != ".data" || stem.empty() ||
+                    !std::all_of(stem.begin(), stem.end(), [](char c) { return c >= '0' && c <= '9'; }))
+                    continue;
+                uint64_t id = 0;
+                auto r = std::from_chars(stem.data(), stem.data() + stem.size(), id);
+                if (r.ec != std::errc() || id > UINT32_MAX) continue;   // not one of ours
+                ids.push_back(static_cast<uint32_t>(id));
+            }
+            if (ec) return false;
+            std::sort(ids.begin(), ids.end());
+
+            for (uint32_t id : ids) {
+                int fd = ::open(file_name(id, "data").c_str(), O_RDONLY);
+                if (fd < 0) return false;
+                files[id] = fd;
+                if (!load_hint(id) && !load_data(id)) return false;
+            }
+            return open_active(ids.empty() ? 1 : ids.back() + 1);
+        }
+
+        // Waits for a running compaction, then closes all files.
+        void close() {
+            if (compactor.joinable()) compactor.join();
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            for (auto& f : files) ::close(f.second);
+            files.clear();
+            keydir = KeyDir();
+            active_fd = -1;
+            active_id = 0;
+            active_size = 0;
+        }
+
+        bool put(const std::string& key, const std::string& value) {
+            if (key.size() >= TOMBSTONE || value.size() >= TOMBSTONE) return false;
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            uint64_t value_offset;
+            if (!append(key, value.data(), static_cast<uint32_t>(value.size()), value_offset)) return false;
+            keydir.upsert(key, active_id, static_cast<uint32_t>(value.size()), value_offset);
+            return true;
+        }
+
+        bool del(const std::string& key) {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            if (!keydir.find(key)) return true;
+            uint64_t value_offset;
+            if (!append(key, nullptr, TOMBSTONE, value_offset)) return false;
+            keydir.erase(key);
+            return true;
+        }
+
+        // One keydir probe and one pread(). Returns false if absent or on I/O error.
+        bool get(const std::string& key, std::string& value) const {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            const KeyDirEntry* e = keydir.find(key);
+            if (!e) return false;
+            value.resize(e->value_size);
+            return read_exact(files.at(e->file_id), &value[0], e->value_size, e->value_offset);
+        }
+
+        size_t size() const {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            return keydir.size();
+        }
+
+        // Merge all immutable data files into one. Returns false on I/O error or if a
+        // compaction is already running.
+        bool compact() {
+            if (compacting.exchange(true)) return false;
+            bool ok = run_compaction();
+            compaction_ok = ok;
+            compacting = false;
+            return ok;
+        }
+
+        // Start compact() on a background thread. Returns false if one is running.
+        // The outcome is reported by last_compaction_ok() once it finishes.
+        bool compact_async() {
+            if (compacting.exchange(true)) return false;
+            if (compactor.joinable()) compactor.join();
+            compactor = std::thread([this] { compaction_ok = run_compaction(); compacting = false; });
+            return true;
+        }
+
+        // Result of the most recent finished compaction, true if none has run yet.
+        // Poll after compact_async(), or call close() first to wait for it.
+        bool last_compaction_ok() const noexcept { return compaction_ok; }
+
+        static uint64_t record_check(const std::string& key, const char* value, uint32_t value_size) noexcept {
+            CompactHash h;
+            h.insert(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+            if (value_size != TOMBSTONE)
+                h.insert(reinterpret_cast<const uint8_t*>(value), value_size);
+            h.insert(reinterpret_cast<const uint8_t*>(&value_size), sizeof(value_size));
+            return h.finalize();
+        }
+
+    private:
+        std::string file_name(uint32_t id, const char* ext) const {
+            char name[32];
+            snprintf(name, sizeof(name), "%09u.%s", id, ext);
+            return path + "/" + name;
+        }
+
+        static bool read_exact(int fd, char* p, size_t n, uint64_t offset) noexcept {
+            while (n > 0) {
+                ssize_t r = pread(fd, p, n, static_cast<off_t>(offset));
+                if (r <= 0) return false;
+                p += r;
+                n -= static_cast<size_t>(r);
+                offset += static_cast<uint64_t>(r);
+            }
+            return true;
+        }
+
+        static bool write_all(int fd, const struct iovec* iov, int iovcnt, size_t total) noexcept {
+            // records are small; a short write is retried as a plain byte stream
+            ssize_t w = writev(fd, iov, iovcnt);
+            if (w < 0) return false;
+            size_t done = static_cast<size_t>(w);
+            for (int i = 0; i < iovcnt && done < total; ++i) {
+                size_t len = iov[i].iov_len;
+                if (done >= len) { done -= len; total -= len; continue; }
+                const char* p = static_cast<const char*>(iov[i].iov_base) + done;
+                size_t left = len - done;
+                while (left > 0) {
+                    ssize_t r = ::write(fd, p, left);
+                    if (r <= 0) return false;
+                    p += r;
+                    left -= static_cast<size_t>(r);
+                }
+                total -= len;
+                done = 0;
+            }
+            return true;
+        }
+
+        // Sequential buffered reader used when replaying data and hint files.
+        struct FileReader {
+            FILE* f;
+            explicit FileReader(const std::string& name) : f(fopen(name.c_str(), "rb")) {}
+            ~FileReader() { if (f) fclose(f); }
+            bool read(void* p, size_t n) { return n == 0 || fread(p, 1, n, f) == n; }
+            uint64_t size() const {
+                struct stat st;
+                return fstat(fileno(f), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+            }
+        };
+
+        static uint64_t fd_size(int fd) noexcept {
+            struct stat st;
+            return fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+        }
+
+        // Hint entries carry no checksum: the whole file is validated against the data
+        // file's size before any entry is applied. Returns false (caller replays the data
+        // file instead) on a missing, truncated or inconsistent hint file.
+        bool load_hint(uint32_t id) {
+            FileReader r(file_name(id, "hint"));
+            if (!r.f) return false;
+            const uint64_t hint_size = r.size();
+            const uint64_t data_size = fd_size(files.at(id));
+            struct Hint { std::string key; uint32_t value_size; uint64_t value_offset; };
+            std::vector<Hint> hints;
+            HintHeader h;
+            uint64_t offset = 0;
+            while (r.read(&h, sizeof(h))) {
+                offset += sizeof(h);
+                if (h.key_size > hint_size - offset || h.value_size == TOMBSTONE ||
+                    h.value_offset > data_size || h.value_size > data_size - h.value_offset)
+                    return false;
+                hints.push_back({ std::string(h.key_size, '\0'), h.value_size, h.value_offset });
+                if (!r.read(&hints.back().key[0], h.key_size)) return false;
+                offset += h.key_size;
+            }
+            if (offset != hint_size) return false;      // torn header at the end
+            for (const Hint& e : hints) keydir.upsert(e.key, id, e.value_size, e.value_offset);
+            return true;
+        }
+
+        // Replay a data file. A torn or corrupt tail (crash during append) ends the
+        // replay of that file; everything before it is kept.
+        bool load_data(uint32_t id) {
+            FileReader r(file_name(id, "data"));
+            if (!r.f) return false;
+            const uint64_t file_size = r.size();
+            RecordHeader h;
+            std::string key, value;
+            uint64_t offset = 0;
+            while (r.read(&h, sizeof(h))) {
+                uint64_t payload = uint64_t(h.key_size) + (h.value_size == TOMBSTONE ? 0 : h.value_size);
+                if (payload > file_size - offset - sizeof(h)) break;   // corrupt sizes: don't allocate them
+                key.resize(h.key_size);
+                value.resize(h.value_size == TOMBSTONE ? 0 : h.value_size);
+                if (!r.read(&key[0], key.size()) || !r.read(&value[0], value.size())) break;
+                if (record_check(key, value.data(), h.value_size) != h.check) break;
+
+                if (h.value_size == TOMBSTONE) keydir.erase(key);
+                else keydir.upsert(key, id, h.value_size, offset + sizeof(h) + h.key_size);
+                offset += sizeof(h) + payload;
+            }
+            return true;
+        }
+
+        // Drop whatever a failed append left past active_size, so the next record starts
+        // where the keydir expects it and replay does not stop at a torn record. If the
+        // file cannot be truncated, later writes go to a fresh active file instead; until
+        // one can be created, appends fail rather than land after the torn bytes.
+        void discard_tail() {
+            if (ftruncate(active_fd, static_cast<off_t>(active_size)) == 0) return;
+            if (!open_active(active_id + 1)) active_fd = -1;
+        }
+
+        bool open_active(uint32_t id) {
+            int fd = ::open(file_name(id, "data").c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+            if (fd < 0) return false;
+            files[id] = fd;
+            active_fd = fd;
+            active_id = id;
+            active_size = 0;
+            return true;
+        }
+
+        // Append one record to the active file. Caller holds the exclusive lock.
+        bool append(const std::string& key, const char* value, uint32_t value_size, uint64_t& value_offset) {
+            if ((active_fd < 0 || active_size >= options.max_file_size) && !open_active(active_id + 1)) return false;
+
+            uint32_t payload = value_size == TOMBSTONE ? 0 : value_size;
+            RecordHeader h{ record_check(key, value, value_size), static_cast<uint32_t>(key.size()), value_size };
+            struct iovec iov[3] = {
+                { &h, sizeof(h) },
+                { const_cast<char*>(key.data()), key.size() },
+                { const_cast<char*>(value), payload },
+            };
+            size_t total = sizeof(h) + key.size() + payload;
+            if (!write_all(active_fd, iov, 3, total) || (options.sync_writes && fsync(active_fd) != 0)) {
+                discard_tail();
+                return false;
+            }
+
+            value_offset = active_size + sizeof(h) + key.size();
+            active_size += total;
+            return true;
+        }
+
+        // Make renames in the store directory durable.
+        bool sync_directory() const {
+            int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+            if (fd < 0) return false;
+            bool ok = fsync(fd) == 0;
+            ::close(fd);
+            return ok;
+        }
+
+        bool run_compaction() {
+            struct Live { std::string key; uint32_t file_id; uint32_t value_size; uint64_t value_offset; };
+            std::vector<Live> live;
+            std::vector<uint32_t> old_ids;
+            uint32_t merged_id;
+
+            // Freeze the current active file; the merged file takes the id right after it
+            // so that replay order still puts newer writes last.
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                merged_id = active_id + 1;
+                if (!open_active(active_id + 2)) return false;
+                for (const auto& f : files)
+                    if (f.first < merged_id) old_ids.push_back(f.first);
+                keydir.for_each([&](const KeyDirEntry& e) {
+                    if (e.file_id < merged_id)
+                        live.push_back({ e.key, e.file_id, e.value_size, e.value_offset });
+                });
+            }
+
+            // Copy outside the lock: immutable files are never modified. Output goes to
+            // temporary names until it is complete and durable.
+            const std::string data_name = file_name(merged_id, "data"), hint_name = file_name(merged_id, "hint");
+            const std::string data_tmp = data_name + ".tmp", hint_tmp = hint_name + ".tmp";
+            int data_fd = ::open(data_tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            int hint_fd = ::open(hint_tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            bool ok = data_fd >= 0 && hint_fd >= 0;
+            std::vector<uint64_t> new_offsets(live.size());
+            std::string value;
+            uint64_t offset = 0;
+            for (size_t i = 0; ok && i < live.size(); ++i) {
+                const Live& e = live[i];
+                value.resize(e.value_size);
+                int src;
+                {
+                    std::shared_lock<std::shared_mutex> lock(mutex);
+                    src = files.at(e.file_id);
+                }
+                ok = read_exact(src, &value[0], e.value_size, e.value_offset);
+                if (!ok) break;
+
+                RecordHeader h{ record_check(e.key, value.data(), e.value_size),
+                    static_cast<uint32_t>(e.key.size()), e.value_size };
+                struct iovec rec[3] = {
+                    { &h, sizeof(h) },
+                    { const_cast<char*>(e.key.data()), e.key.size() },
+                    { &value[0], value.size() },
+                };
+                new_offsets[i] = offset + sizeof(h) + e.key.size();
+                HintHeader hh{ h.key_size, e.value_size, new_offsets[i] };
+                struct iovec hint[2] = {
+                    { &hh, sizeof(hh) },
+                    { const_cast<char*>(e.key.data()), e.key.size() },
+                };
+                size_t total = sizeof(h) + e.key.size() + value.size();
+                ok = write_all(data_fd, rec, 3, total) &&
+                     write_all(hint_fd, hint, 2, sizeof(hh) + e.key.size());
+                offset += total;
+            }
+            ok = ok && fsync(data_fd) == 0 && fsync(hint_fd) == 0;
+            if (hint_fd >= 0) ::close(hint_fd);
+            // data before hint: a hint file must never exist without its data file
+            ok = ok && rename(data_tmp.c_str(), data_name.c_str()) == 0;
+            ok = ok && rename(hint_tmp.c_str(), hint_name.c_str()) == 0;
+            ok = ok && sync_directory();
+            if (!ok) {
+                if (data_fd >= 0) ::close(data_fd);
+                unlink(data_tmp.c_str());
+                unlink(hint_tmp.c_str());
+                unlink(hint_name.c_str());
+                unlink(data_name.c_str());
+                return false;
+            }
+
+            // Repoint entries not overwritten meanwhile, then retire the old files.
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            files[merged_id] = data_fd;
+            for (size_t i = 0; i < live.size(); ++i) {
+                const Live& e = live[i];
+                const KeyDirEntry* cur = keydir.find(e.key);
+                if (cur && cur->file_id == e.file_id && cur->value_offset == e.value_offset)
+                    keydir.upsert(e.key, merged_id, e.value_size, new_offsets[i]);
+            }
+            for (uint32_t id : old_ids) {
+                ::close(files[id]);
+                files.erase(id);
+                unlink(file_name(id, "data").c_str());
+                unlink(file_name(id, "hint").c_str());
+            }
+            return true;
+        }
+
+        std::string path;
+        KvStoreOptions options;
+        mutable std::shared_mutex mutex;     // guards keydir, files and the active file
+        KeyDir keydir;
+        std::map<uint32_t, int> files;       // file id -> read fd (active file included)
+        int active_fd = -1;
+        uint32_t active_id = 0;
+        uint64_t active_size = 0;
+        std::atomic<bool> compacting{ false };
+        std::atomic<bool> compaction_ok{ true };
+        std::thread compactor;
+    };//class KvStore
+
+}//namespace compact_hash
@@ -0,0 +1,310 @@
+#pragma once
+// File: memoize.h
+// Description: Memoization of pure functions in a bounded, sharded, thread-safe cache keyed by argument hashes
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t, uint32_t
+#include <cstddef>      // size_t
+#include <functional>   // std::function
+#include <memory>       // std::unique_ptr shard array
+#include <mutex>        // std::mutex, std::lock_guard
+#include <optional>     // std::optional cached entry
+#include <string>       // std::string arguments
+#include <string_view>  // std::string_view arguments
+#include <tuple>        // std::tuple argument keys
+#include <type_traits>  // std::decay_t, std::conditional_t, std::void_t
+#include <utility>      // std::pair, std::move, std::index_sequence
+#include <vector>       // std::vector
+
+#include "compact_hash.h"
+#include "compact_hasher.h" // CompactHasher, structured hashing of the argument tuple
+#include "process_seed.h"
+#include "SplitMix64.h"     // seeds of the 128-bit digest
+
+/*
+compact_hash::memoize - Cache results of an expensive pure function by its arguments
+
+memoize(f, capacity) wraps f so that a call with arguments seen before returns the
+cached result instead of calling f. The arguments, as a std::tuple, are hashed with
+CompactHasher's structured path (one word per argument; strings by content), so
+any argument type CompactHasher accepts works, including nested pairs and tuples.
+
+Key modes:
+    MemoKey::ARGUMENTS  each entry stores a copy of the arguments; a hit needs the
+                        hash and the arguments to be equal, so results are exact.
+                        std::string_view and char pointers (also inside pairs and
+                        tuples) are stored as std::string, so the cache never points
+                        into the caller's memory and compares them by content
+    MemoKey::DIGEST128  each entry stores a 128-bit digest (two CompactHasher hashes
+                        under independent seeds, as compact_hash_extended derives them)
+                        instead of the arguments: constant size per entry whatever the
+                        arguments, at a collision risk of about n^2 / 2^129 for n keys
+
+The cache is bounded: capacity entries split over up to 16 shards, each behind its
+own mutex, and within a shard into 4-way sets. A full set evicts with CLOCK (second
+chance): entries hit since the last sweep survive one more. f runs outside any
+lock, so two threads missing on the same arguments at once may both call f; the
+later result overwrites the earlier one, which is harmless for a pure function.
+
+Result and argument types must be copyable; results are returned by value.
+
+Effective capacity: a key can live only in the 4 ways of its set, so keys that
+hash to a full set evict each other while other sets still have room. capacity()
+bounds memory, not the number of keys kept: conflict misses start well below
+n = capacity() distinct keys (500 keys cycled through a cache of capacity 1024
+still miss on about 13% of repeated calls). Size the cache at 2-4x the working
+set you want to keep hot.
+
+Limits (each rejected at compile time with a static_assert naming it):
+    - parameters may be values or const references; a non-const lvalue reference
+      parameter (an output argument) cannot be memoized, and an rvalue reference
+      parameter cannot be, since the cache must keep its own copy of the argument
+    - f must return a value; a void function has no result to cache
+    - argument types must be hashable by CompactHasher: strings, numbers, enums,
+      pointers, padding-free trivially copyable types, and pairs or tuples of
+      those; char pointers must not be null; containers such as std::vector<int>
+      are not hashable (reduce them to a digest, or pass their bytes as a
+      string_view, which is copied into the entry, and memoize on that)
+    - f must have a single non-template call operator (a function pointer, a
+      non-generic lambda, a functor, a std::function) so the signature can be
+      deduced; wrap a generic lambda in std::function<R(Args...)> first
+
+API:
+    auto m = memoize(f, capacity, seed = process_seed());           // MemoKey::ARGUMENTS
+    auto m = memoize<MemoKey::DIGEST128>(f, capacity, seed);
+    R r = m(args...);
+    uint64_t h = m.hits(), n = m.misses();
+    size_t s = m.size();
+    m.clear();
+
+Usage example:
+
+    auto price = compact_hash::memoize(
+        [](const std::string& sku, int qty) { return quote_from_pricing_service(sku, qty); },
+        100000);
+    double p = price("A-1234", 3);      // computed
+    double q = price("A-1234", 3);      // cached
+*/
+
+namespace compact_hash {
+
+    enum class MemoKey { ARGUMENTS, DIGEST128 };
+
+    namespace detail {
+        // What CompactHasher accepts as one element of the argument tuple.
+        template <class T> struct is_memo_hashable : std::bool_constant<
+            std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value ||
+            std::has_unique_object_representations<T>::value> {};
+        template <> struct is_memo_hashable<long double> : std::false_type {};
+        template <> struct is_memo_hashable<std::string> : std::true_type {};
+        template <> struct is_memo_hashable<std::string_view> : std::true_type {};
+        template <class A, class B> struct is_memo_hashable<std::pair<A, B>>
+            : std::bool_constant<is_memo_hashable<A>::value && is_memo_hashable<B>::value> {};
+        template <class... Ts> struct is_memo_hashable<std::tuple<Ts...>>
+            : std::bool_constant<(is_memo_hashable<Ts>::value && ...)> {};
+
+        // Owning form of an argument for the stored key: views and C strings become std::string.
+        template <class T> struct memo_stored { using type = T; };
+        template <> struct memo_stored<std::string_view> { using type = std::string; };
+        template <> struct memo_stored<const char*> { using type = std::string; };
+        template <> struct memo_stored<char*> { using type = std::string; };
+        template <class A, class B> struct memo_stored<std::pair<A, B>> {
+            using type = std::pair<typename memo_stored<A>::type, typename memo_stored<B>::type>;
+        };
+        template <class... Ts> struct memo_stored<std::tuple<Ts...>> {
+            using type = std::tuple<typename memo_stored<Ts>::type...>;
+        };
+
+        // Stored key == call key, element by element (std::pair has no mixed-type ==).
+        template <class S, class K> bool memo_equal(const S& s, const K& k);
+        template <class A, class B, class C, class D> bool memo_equal(const std::pair<A, B>& s, const std::pair<C, D>& k);
+        template <class... Ss, class... Ks> bool memo_equal(const std::tuple<Ss...>& s, const std::tuple<Ks...>& k);
+        template <class S, class K, size_t... I>
+        bool memo_equal_elements(const S& s, const K& k, std::index_sequence<I...>) {
+            return (memo_equal(std::get<I>(s), std::get<I>(k)) && ...);
+        }
+        template <class S, class K> bool memo_equal(const S& s, const K& k) { return s == k; }
+        template <class A, class B, class C, class D> bool memo_equal(const std::pair<A, B>& s, const std::pair<C, D>& k) {
+            return memo_equal(s.first, k.first) && memo_equal(s.second, k.second);
+        }
+        template <class... Ss, class... Ks> bool memo_equal(const std::tuple<Ss...>& s, const std::tuple<Ks...>& k) {
+            return memo_equal_elements(s, k, std::index_sequence_for<Ss...>());
+        }
+
+        template <class T> struct is_output_parameter
+            : std::bool_constant<std::is_lvalue_reference<T>::value && !std::is_const<std::remove_reference_t<T>>::value> {};
+
+        template <class F, class = void> struct has_plain_call_operator : std::false_type {};
+        template <class F> struct has_plain_call_operator<F, std::void_t<decltype(&F::operator())>> : std::true_type {};
+    }//namespace detail
+
+    template <MemoKey KEY, class R, class... Args>
+    class Memoized {
+        static_assert(!(detail::is_output_parameter<Args>::value || ...),
+            "memoize: non-const lvalue reference parameters (output arguments) cannot be memoized");
+        static_assert(!(std::is_rvalue_reference<Args>::value || ...),
+            "memoize: rvalue reference parameters cannot be memoized; take the argument by value or const reference");
+        static_assert(!std::is_void<R>::value,
+            "memoize: f returns void, so there is no result to cache");
+        static_assert((detail::is_memo_hashable<std::decay_t<Args>>::value && ...),
+            "memoize: argument types must be hashable by CompactHasher (strings, numbers, enums, pointers, "
+            "padding-free trivially copyable types, pairs/tuples of those); containers such as std::vector are not");
+
+    public:
+        using Function = std::function<R(Args...)>;
+        using Key = std::tuple<std::decay_t<Args>...>;
+
+        Memoized(Function f, size_t capacity, uint64_t seed = process_seed())
+            : f(std::move(f)), hasher(digest_seed(seed, 0)), checker(digest_seed(seed, 1))
+        {
+            while (shard_bits < MAX_SHARD_BITS && (capacity >> (shard_bits + 1)) >= MIN_SHARD_CAPACITY) ++shard_bits;
+            const size_t shard_count = size_t(1) << shard_bits;
+            size_t per_shard = (capacity + shard_count - 1) >> shard_bits;
+            sets = static_cast<uint32_t>((per_shard + WAYS - 1) / WAYS);
+            if (sets == 0) sets = 1;
+            shards.reset(new Shard[shard_count]);
+            for (size_t s = 0; s < shard_count; ++s) shards[s].entries.resize(size_t(sets) * WAYS);
+        }
+
+        R operator()(const Args&... args) {
+            Key key(args...);
+            const uint64_t h = hash_of(key);
+            const uint64_t check = check_of(key);
+            Shard& shard = shards[fastrange_pow2(h, shard_bits)];
+            const size_t set = size_t(fastrange32(static_cast<uint32_t>(h), sets)) * WAYS;
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                for (size_t w = 0; w < WAYS; ++w) {
+                    Entry& e = shard.entries[set + w];
+                    if (e.hash == h && e.check == check && same_key(e, key)) {
+                        e.referenced = true;
+                        ++shard.hits;
+                        return e.item->second;
+                    }
+                }
+                ++shard.misses;
+            }
+
+            R result = f(args...);
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            Entry* victim = nullptr;
+            for (size_t w = 0; w < WAYS && !victim; ++w) {      // same key (another thread won), else a free way
+                Entry& e = shard.entries[set + w];
+                if ((e.hash == h && e.check == check && same_key(e, key)) || e.hash == 0) victim = &e;
+            }
+            while (!victim) {                                   // CLOCK over the set
+                Entry& e = shard.entries[set + shard.hand[set / WAYS % HANDS]++ % WAYS];
+                if (e.referenced) e.referenced = false;
+                else victim = &e;
+            }
+            if (victim->hash == 0) ++shard.count;
+            victim->hash = h;
+            victim->check = check;
+            victim->referenced = false;
+            victim->item.emplace(stored_key(std::move(key)), result);
+            return result;
+        }
+
+        uint64_t hits() const { return sum(&Shard::hits); }
+        uint64_t misses() const { return sum(&Shard::misses); }
+        size_t size() const { return static_cast<size_t>(sum(&Shard::count)); }
+        size_t capacity() const noexcept { return (size_t(1) << shard_bits) * sets * WAYS; }
+
+        // Drop all cached results and reset the counters.
+        void clear() {
+            for (size_t s = 0; s < (size_t(1) << shard_bits); ++s) {
+                Shard& shard = shards[s];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                for (Entry& e : shard.entries) e = Entry();
+                shard.hits = shard.misses = shard.count = 0;
+            }
+        }
+
+    private:
+        static constexpr size_t WAYS = 4;
+        static constexpr unsigned MAX_SHARD_BITS = 4;       // up to 16 shards
+        static constexpr size_t MIN_SHARD_CAPACITY = 64;    // fewer, larger shards for small caches
+        static constexpr size_t HANDS = 64;                 // CLOCK hands per shard, shared by sets modulo HANDS
+
+        using StoredKey = std::conditional_t<KEY == MemoKey::ARGUMENTS,
+            typename detail::memo_stored<Key>::type, std::tuple<>>;
+
+        struct Entry {
+            uint64_t hash = 0;          // 0 = empty
+            uint64_t check = 0;         // high half of the digest (DIGEST128), else 0
+            bool referenced = false;
+            std::optional<std::pair<StoredKey, R>> item;
+        };
+
+        struct alignas(64) Shard {
+            std::mutex mutex;
+            std::vector<Entry> entries;     // sets * WAYS
+            uint8_t hand[HANDS] = {};
+            uint64_t hits = 0, misses = 0, count = 0;
+        };
+
+        // i-th output of SplitMix64(seed), like the per-word seeds of compact_hash_extended.
+        static uint64_t digest_seed(uint64_t seed, int i) noexcept {
+            RNG::SplitMix64 g(seed);
+            uint64_t s = g();
+            while (i-- > 0) s = g();
+            return s;
+        }
+
+        uint64_t hash_of(const Key& key) const noexcept {
+            uint64_t h = hasher(key);
+            return h | (h == 0);
+        }
+
+        uint64_t check_of(const Key& key) const noexcept {
+            if constexpr (KEY == MemoKey::DIGEST128) return checker(key);
+            else return 0;
+        }
+
+        static bool same_key(const Entry& e, const Key& key) {
+            if constexpr (KEY == MemoKey::ARGUMENTS) return e.item && detail::memo_equal(e.item->first, key);
+            else return true;
+        }
+
+        static StoredKey stored_key(Key&& key) {
+            if constexpr (KEY == MemoKey::ARGUMENTS) return StoredKey(std::move(key));
+            else return StoredKey();
+        }
+
+        uint64_t sum(uint64_t Shard::* counter) const {
+            uint64_t total = 0;
+            for (size_t s = 0; s < (size_t(1) << shard_bits); ++s) {
+                std::lock_guard<std::mutex> lock(shards[s].mutex);
+                total += shards[s].*counter;
+            }
+            return total;
+        }
+
+        Function f;
+        CompactHasher hasher;       // hash: shard, set, and the low half of the digest
+        CompactHasher checker;      // independent seed: high half of the digest
+        unsigned shard_bits = 0;
+        uint32_t sets = 1;          // per shard
+        std::unique_ptr<Shard[]> shards;
+    };//class Memoized
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    namespace detail {
+        template <MemoKey KEY, class R, class... Args>
+        Memoized<KEY, R, Args...> make_memoized(std::function<R(Args...)> f, size_t capacity, uint64_t seed) {
+            return Memoized<KEY, R, Args...>(std::move(f), capacity, seed);
+        }
+    }//namespace detail
+
+    // Wrap a function pointer, lambda or functor with a non-template call operator.
+    template <MemoKey KEY = MemoKey::ARGUMENTS, class F>
+    auto memoize(F f, size_t capacity, uint64_t seed = process_seed()) {
+        static_assert(std::is_pointer<F>::value || detail::has_plain_call_operator<F>::value,
+            "memoize: cannot deduce the signature of a generic lambda or overloaded functor; "
+            "pass std::function<R(Args...)>(f) instead");
+        return detail::make_memoized<KEY>(std::function(std::move(f)), capacity, seed);
+    }
+
+}//namespace compact_hash
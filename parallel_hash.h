@@ -0,0 +1,211 @@
+#pragma once
+// File: parallel_hash.h
+// Description: Parallel batch hashing of (pointer, length) items on a work-stealing thread pool
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>              // uint64_t, uint8_t
+#include <cstddef>              // size_t
+#include <algorithm>            // std::min, std::max
+#include <atomic>               // std::atomic
+#include <condition_variable>   // std::condition_variable
+#include <functional>           // std::function
+#include <memory>               // std::unique_ptr
+#include <mutex>                // std::mutex
+#include <thread>               // std::thread
+#include <vector>               // std::vector
+
+#include "compact_hash.h"
+
+/*
+compact_hash::parallel_hash - Hash a large array of variable-length items on all cores
+
+out[i] = compact_hash(items[i].data, items[i].size, seed), computed by a persistent
+HashThreadPool. The calling thread works too.
+
+Scheduling:
+    Every worker starts with an equal slice of the index range. It claims chunks
+    from the front of its own slice; a worker that runs dry steals the back half
+    of the slice with the most items left. Chunks shrink as a slice drains
+    (1/8 of what is left) and are capped at roughly CHUNK_BYTES of input, using
+    the average item size sampled up front, so 16-byte keys are claimed thousands
+    at a time while multi-megabyte records go one by one.
+
+API:
+    HashThreadPool pool(threads = hardware_concurrency);
+    void parallel_hash(pool, items, n, out, seed = 0);
+
+Usage example:
+
+    compact_hash::HashThreadPool pool;
+    std::vector<compact_hash::HashItem> items = ...;
+    std::vector<uint64_t> out(items.size());
+    compact_hash::parallel_hash(pool, items.data(), items.size(), out.data());
+*/
+
+namespace compact_hash {
+
+    struct HashItem {
+        const uint8_t* data;
+        size_t size;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    class HashThreadPool {
+    public:
+        explicit HashThreadPool(unsigned threads = std::thread::hardware_concurrency()) {
+            if (threads == 0) threads = 1;
+            for (unsigned w = 1; w < threads; ++w)
+                workers.emplace_back([this, w] { worker_loop(w); });
+        }
+
+        ~HashThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& t : workers) t.join();
+        }
+
+        HashThreadPool(const HashThreadPool&) = delete;
+        HashThreadPool& operator=(const HashThreadPool&) = delete;
+
+        // Number of workers, including the calling thread.
+        unsigned size() const noexcept { return static_cast<unsigned>(workers.size()) + 1; }
+
+        // Run job(worker_index) on every worker and wait for all of them. The caller
+        // is worker 0. Jobs from different threads are serialized.
+        void run(const std::function<void(unsigned)>& job) {
+            std::lock_guard<std::mutex> serialize(run_mutex);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                current = &job;
+                pending = static_cast<unsigned>(workers.size());
+                ++generation;
+            }
+            wake.notify_all();
+            job(0);
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this] { return pending == 0; });
+            current = nullptr;
+        }
+
+    private:
+        void worker_loop(unsigned w) {
+            uint64_t seen = 0;
+            for (;;) {
+                const std::function<void(unsigned)>* job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&] { return stopping || generation != seen; });
+                    if (stopping) return;
+                    seen = generation;
+                    job = current;
+                }
+                (*job)(w);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) done.notify_one();
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::mutex run_mutex;
+        std::mutex mutex;
+        std::condition_variable wake, done;
+        const std::function<void(unsigned)>* current = nullptr;
+        uint64_t generation = 0;
+        unsigned pending = 0;
+        bool stopping = false;
+    };//class HashThreadPool
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    namespace detail {
+
+        // A worker's remaining slice [begin, end). Padded so slices never share a line.
+        struct alignas(64) WorkRange {
+            std::mutex lock;
+            size_t begin = 0;
+            size_t end = 0;
+        };
+
+        // Claim up to max_items from the front of r. Returns false if r is empty.
+        inline bool claim(WorkRange& r, size_t max_items, size_t& b, size_t& e) {
+            std::lock_guard<std::mutex> lock(r.lock);
+            if (r.begin >= r.end) return false;
+            size_t left = r.end - r.begin;
+            size_t take = std::min(max_items, std::max<size_t>(1, left / 8));
+            b = r.begin;
+            e = r.begin + take;
+            r.begin = e;
+            return true;
+        }
+
+        // Move the back half of the fullest other range into mine. Returns false when
+        // every range is empty, i.e. all work has been claimed.
+        inline bool steal(std::unique_ptr<WorkRange[]>& ranges, unsigned n, unsigned me) {
+            for (;;) {
+                unsigned victim = n;
+                size_t most = 0;
+                for (unsigned v = 0; v < n; ++v) {
+                    if (v == me) continue;
+                    std::lock_guard<std::mutex> lock(ranges[v].lock);
+                    size_t left = ranges[v].end - ranges[v].begin;
+                    if (left > most) { most = left; victim = v; }
+                }
+                if (victim == n) return false;
+
+                size_t b, e;
+                {
+                    std::lock_guard<std::mutex> lock(ranges[victim].lock);
+                    size_t left = ranges[victim].end - ranges[victim].begin;
+                    if (left == 0) continue;            // drained meanwhile, look again
+                    size_t half = (left + 1) / 2;
+                    e = ranges[victim].end;
+                    b = e - half;
+                    ranges[victim].end = b;
+                }
+                std::lock_guard<std::mutex> lock(ranges[me].lock);
+                ranges[me].begin = b;
+                ranges[me].end = e;
+                return true;
+            }
+        }
+
+    }//namespace detail
+
+    // Target input bytes per claimed chunk: large enough to amortize the claim,
+    // small enough that the tail of a job balances across workers.
+    constexpr size_t CHUNK_BYTES = 256 * 1024;
+
+    inline void parallel_hash(HashThreadPool& pool, const HashItem* items, size_t n, uint64_t* out,
+        uint64_t seed = 0)
+    {
+        if (n == 0) return;
+        const unsigned workers = pool.size();
+
+        // Sample the average item size to turn CHUNK_BYTES into an item count.
+        size_t step = std::max<size_t>(1, n / 1024), sampled = 0, bytes = 0;
+        for (size_t i = 0; i < n; i += step, ++sampled) bytes += items[i].size;
+        size_t avg = std::max<size_t>(1, bytes / sampled);
+        size_t max_items = std::max<size_t>(1, CHUNK_BYTES / avg);
+
+        std::unique_ptr<detail::WorkRange[]> ranges(new detail::WorkRange[workers]);
+        for (unsigned w = 0; w < workers; ++w) {
+            ranges[w].begin = n * w / workers;
+            ranges[w].end = n * (w + 1) / workers;
+        }
+
+        pool.run([&](unsigned w) {
+            size_t b, e;
+            for (;;) {
+                while (detail::claim(ranges[w], max_items, b, e))
+                    for (size_t i = b; i < e; ++i)
+                        out[i] = compact_hash(items[i].data, items[i].size, seed);
+                if (!detail::steal(ranges, workers, w)) return;
+            }
+        });
+    }//parallel_hash
+
+}//namespace compact_hash
@@ -0,0 +1,210 @@
+#pragma once
+// File: perf_counters.h
+// Description: Optional hardware performance counter instrumentation around hashing call-sites
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t
+#include <cstdio>       // FILE, fprintf
+#include <atomic>       // std::atomic
+#include <mutex>        // std::mutex
+#include <vector>       // std::vector of registered sites
+
+#if defined(__linux__)
+#include <cstring>              // memset
+#include <linux/perf_event.h>   // perf_event_attr, PERF_COUNT_HW_*
+#include <sys/ioctl.h>          // ioctl
+#include <sys/syscall.h>        // SYS_perf_event_open
+#include <unistd.h>             // syscall, read, close
+#endif
+
+/*
+compact_hash::perf - Per call-site cycles, instructions, branch misses and cache misses
+
+Wrap a hashing call-site or batch in COMPACT_HASH_PERF_SCOPE("name"). Counts are
+accumulated per named site and printed with perf::report().
+
+Overhead:
+    - COMPACT_HASH_PERF not defined: the macro expands to nothing.
+    - Defined but perf::enable(false) (the default): one relaxed atomic load per scope.
+    - Enabled: two read() system calls per scope (~1 us), so scope batches, not
+      single small-key hashes.
+
+Counters come from perf_event_open on Linux, opened lazily once per thread as one
+group (cycles leader plus instructions, branch misses, cache misses), user space
+only. Where perf events are unavailable (other OSes, perf_event_paranoid, many
+containers) scopes still count calls and perf::available() returns false.
+
+API:
+    perf::enable(bool on);
+    bool perf::available();
+    void perf::report(FILE* out = stdout);
+    COMPACT_HASH_PERF_SCOPE("site name");
+
+Usage example:
+
+    #define COMPACT_HASH_PERF
+    #include "perf_counters.h"
+
+    compact_hash::perf::enable(true);
+    {
+        COMPACT_HASH_PERF_SCOPE("ingest batch");
+        for (...) out[i] = compact_hash::compact_hash(p[i], n[i]);
+    }
+    compact_hash::perf::report();
+*/
+
+namespace compact_hash {
+namespace perf {
+
+    enum Counter { CYCLES, INSTRUCTIONS, BRANCH_MISSES, CACHE_MISSES, NUM_COUNTERS };
+
+    // Accumulated totals for one named call-site. Updated with relaxed atomics, so
+    // sites may be shared between threads.
+    struct Site {
+        const char* name;
+        std::atomic<uint64_t> calls{ 0 };
+        std::atomic<uint64_t> counts[NUM_COUNTERS] = {};
+
+        explicit Site(const char* name) : name(name) { register_site(this); }
+
+        static void register_site(Site* s) {
+            std::lock_guard<std::mutex> lock(registry_mutex());
+            registry().push_back(s);
+        }
+        static std::vector<Site*>& registry() { static std::vector<Site*> r; return r; }
+        static std::mutex& registry_mutex() { static std::mutex m; return m; }
+    };
+
+    inline std::atomic<bool>& enabled_flag() { static std::atomic<bool> on{ false }; return on; }
+
+    inline void enable(bool on) noexcept { enabled_flag().store(on, std::memory_order_relaxed); }
+    inline bool enabled() noexcept { return enabled_flag().load(std::memory_order_relaxed); }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // One counter group per thread, opened on first use.
+    class ThreadCounters {
+    public:
+        bool ok() const noexcept { return leader >= 0; }
+
+        // Current counter values; returns false if counters are unavailable.
+        bool read(uint64_t values[NUM_COUNTERS]) const noexcept {
+#if defined(__linux__)
+            if (leader < 0) return false;
+            uint64_t buf[1 + NUM_COUNTERS];   // PERF_FORMAT_GROUP: { nr, value[nr] }
+            if (::read(leader, buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf)) || buf[0] != NUM_COUNTERS)
+                return false;
+            for (int i = 0; i < NUM_COUNTERS; ++i) values[i] = buf[1 + i];
+            return true;
+#else
+            (void)values;
+            return false;
+#endif
+        }
+
+        static ThreadCounters& local() {
+            thread_local ThreadCounters tc;
+            return tc;
+        }
+
+        ~ThreadCounters() {
+#if defined(__linux__)
+            for (int fd : fds)
+                if (fd >= 0) close(fd);
+#endif
+        }
+
+    private:
+        ThreadCounters() {
+#if defined(__linux__)
+            static const uint64_t configs[NUM_COUNTERS] = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES,
+            };
+            for (int i = 0; i < NUM_COUNTERS; ++i) {
+                perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = configs[i];
+                attr.read_format = PERF_FORMAT_GROUP;
+                attr.disabled = i == 0;          // the group starts when the leader is enabled
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0));
+                if (fds[i] < 0) {
+                    for (int j = 0; j < i; ++j) close(fds[j]);
+                    for (int& fd : fds) fd = -1;
+                    return;
+                }
+            }
+            leader = fds[0];
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+        }
+
+        int fds[NUM_COUNTERS] = { -1, -1, -1, -1 };
+        int leader = -1;
+    };//class ThreadCounters
+
+    inline bool available() { return ThreadCounters::local().ok(); }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // RAII measurement of one execution of a scope, added to its Site.
+    class Scope {
+    public:
+        explicit Scope(Site& site) noexcept : site(enabled() ? &site : nullptr) {
+            if (this->site) have = ThreadCounters::local().read(start);
+        }
+
+        ~Scope() {
+            if (!site) return;
+            uint64_t end[NUM_COUNTERS];
+            if (have && ThreadCounters::local().read(end))
+                for (int i = 0; i < NUM_COUNTERS; ++i)
+                    site->counts[i].fetch_add(end[i] - start[i], std::memory_order_relaxed);
+            site->calls.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Site* site;
+        bool have = false;
+        uint64_t start[NUM_COUNTERS];
+    };//class Scope
+
+    // Text report of every site that recorded at least one call.
+    inline void report(FILE* out = stdout) {
+        std::lock_guard<std::mutex> lock(Site::registry_mutex());
+        fprintf(out, "%-32s %12s %16s %16s %8s %14s %14s\n",
+            "site", "calls", "cycles", "instructions", "IPC", "branch-miss", "cache-miss");
+        for (const Site* s : Site::registry()) {
+            uint64_t calls = s->calls.load(std::memory_order_relaxed);
+            if (calls == 0) continue;
+            uint64_t c[NUM_COUNTERS];
+            for (int i = 0; i < NUM_COUNTERS; ++i) c[i] = s->counts[i].load(std::memory_order_relaxed);
+            double ipc = c[CYCLES] ? static_cast<double>(c[INSTRUCTIONS]) / c[CYCLES] : 0.0;
+            fprintf(out, "%-32s %12llu %16llu %16llu %8.2f %14llu %14llu\n", s->name,
+                static_cast<unsigned long long>(calls), static_cast<unsigned long long>(c[CYCLES]),
+                static_cast<unsigned long long>(c[INSTRUCTIONS]), ipc,
+                static_cast<unsigned long long>(c[BRANCH_MISSES]), static_cast<unsigned long long>(c[CACHE_MISSES]));
+        }
+    }
+
+}//namespace perf
+}//namespace compact_hash
+
+#define COMPACT_HASH_PERF_CONCAT_(a, b) a##b
+#define COMPACT_HASH_PERF_CONCAT(a, b) COMPACT_HASH_PERF_CONCAT_(a, b)
+
+#if defined(COMPACT_HASH_PERF)
+#define COMPACT_HASH_PERF_SCOPE(name)                                                             \
+    static ::compact_hash::perf::Site COMPACT_HASH_PERF_CONCAT(compact_hash_perf_site_, __LINE__){ name }; \
+    ::compact_hash::perf::Scope COMPACT_HASH_PERF_CONCAT(compact_hash_perf_scope_, __LINE__){             \
+        COMPACT_HASH_PERF_CONCAT(compact_hash_perf_site_, __LINE__) }
+#else
+#define COMPACT_HASH_PERF_SCOPE(name) ((void)0)
+#endif
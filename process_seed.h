@@ -0,0 +1,78 @@
+#pragma once
+// File: process_seed.h
+// Description: Per-process random seed for hash tables exposed to untrusted keys
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t, uintptr_t
+#include <cstdlib>      // getenv, strtoull
+#include <atomic>       // std::atomic
+#include <chrono>       // fallback entropy when std::random_device fails
+
+#include "SplitMix64.h" // RNG::SplitMix64, RNG::NonDeterministic
+
+/*
+compact_hash::process_seed - Default seed of the hasher adapters and tables
+
+With a fixed seed an attacker who can choose keys (HTTP headers, packet tuples,
+JSON object keys) can precompute keys that collide, turning every lookup in the
+table into a scan of one long chain. process_seed() is drawn once per process
+from std::random_device, so collisions found against one process do not carry
+over to the next.
+
+CompactHasher, FlowHasher, KeyDir (and thus KvStore) and HashIndexBuilder use it
+when no seed is given. The plain functions (compact_hash, compact_hash_words, ...)
+keep seed 0: their digests are values callers store and compare.
+
+Reproducible runs:
+    - set COMPACT_HASH_SEED in the environment (decimal, 0x hex or 0 octal), or
+    - call set_process_seed(seed) before any table is built.
+A table keeps the seed it was constructed with; changing the process seed later
+affects only tables created afterwards.
+
+API:
+    uint64_t process_seed();
+    void set_process_seed(uint64_t seed);
+
+Usage example:
+
+    // tests: pin iteration order of every CompactHasher map in the process
+    compact_hash::set_process_seed(12345ULL);
+*/
+
+namespace compact_hash {
+
+    namespace detail {
+
+        inline uint64_t initial_process_seed() noexcept {
+            if (const char* env = std::getenv("COMPACT_HASH_SEED")) {
+                char* end = nullptr;
+                unsigned long long v = std::strtoull(env, &end, 0);
+                if (end != env && *end == '\0') return v;
+            }
+            try {
+                return RNG::SplitMix64(RNG::NonDeterministic())();
+            }
+            catch (...) {
+                // No entropy source: the clock and the (ASLR) stack address still
+                // differ between runs, which is better than a constant.
+                uint64_t t = static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+                return RNG::SplitMix64(t ^ static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&t)))();
+            }
+        }
+
+        inline std::atomic<uint64_t>& process_seed_slot() noexcept {
+            static std::atomic<uint64_t> seed{ initial_process_seed() };
+            return seed;
+        }
+
+    }//namespace detail
+
+    inline uint64_t process_seed() noexcept {
+        return detail::process_seed_slot().load(std::memory_order_relaxed);
+    }
+
+    inline void set_process_seed(uint64_t seed) noexcept {
+        detail::process_seed_slot().store(seed, std::memory_order_relaxed);
+    }
+
+}//namespace compact_hash
@@ -0,0 +1,480 @@
+// File: quality.cpp
+// Description: Statistical quality checks for compact_hash and its kernels, in the spirit of SMHasher
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+//
+// Build (single translation unit, no dependencies):
+//     g++ -O3 -march=native -std=c++17 quality.cpp -o quality
+// Add -DCOMPACT_HASH_MULTI_SIMD to gate the SIMD multi-buffer kernels.
+//
+// Usage:
+//     ./quality [--filter=KERNEL] [--scale=F]
+//
+// Exit status is 0 when every check passes and 1 otherwise, so the program can gate
+// a new kernel variant before it is adopted. --scale multiplies sample counts
+// (default 1.0, about a minute in total); thresholds follow the sample counts.
+//
+// Checks, run for every registered kernel:
+//     avalanche     flipping any input bit flips each output bit with p = 0.5
+//                   (worst |2p - 1| must stay within 6 standard deviations)
+//     bic           bit independence: output bit flips are pairwise uncorrelated
+//     sparse        keys with very few bits set
+//     cyclic        keys made of a short repeated block
+//     low-entropy   zero keys of every length, counters, short text keys
+//     buckets       chi-square of low-bit and high-bit table indices
+// Collision checks require zero full 64 bit collisions and at most twice the
+// expected number (plus a small Poisson allowance) on each 32 bit half.
+//
+// Multi-buffer equivalence, run once per build:
+//     compact_hash_x4, compact_hash_x8 and compact_hash_multi must return exactly
+//     compact_hash() of every message, over random batches mixing empty messages,
+//     messages under one 16-byte block, unequal lane lengths and batch sizes that
+//     are not a multiple of 4 or 8. Build with and without -DCOMPACT_HASH_MULTI_SIMD
+//     (and with -mavx2 or -mavx512f -mavx512dq) to cover each kernel.
+//
+// To gate a new kernel, add it to KERNELS below. A kernel takes (data, size, seed)
+// and may restrict the key sizes it supports via max_size.
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "compact_hash.h"
+#include "mix64.h"
+#include "multi_hash.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>     // _BitScanForward64
+#endif
+
+namespace {
+
+    inline int ctz64(uint64_t x) {
+#if defined(_MSC_VER)
+        unsigned long i;
+        _BitScanForward64(&i, x);
+        return static_cast<int>(i);
+#else
+        return __builtin_ctzll(x);
+#endif
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Kernels under test
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    uint64_t k_compact_hash(const uint8_t* p, size_t n, uint64_t seed) {
+        return compact_hash::compact_hash(p, n, seed);
+    }
+
+    // Streaming path with irregular chunk boundaries, which exercises the tail
+    // handling between insert() calls.
+    uint64_t k_streaming(const uint8_t* p, size_t n, uint64_t seed) {
+        static const size_t pieces[] = { 1, 7, 3, 16, 5, 33 };
+        compact_hash::CompactHash h(seed);
+        for (size_t i = 0; n > 0; ++i) {
+            size_t take = std::min(n, pieces[i % 6]);
+            h.insert(p, take);
+            p += take;
+            n -= take;
+        }
+        return h.finalize();
+    }
+
+    // Second word of the extended output (the first is checked the same way).
+    uint64_t k_extended(const uint8_t* p, size_t n, uint64_t seed) {
+        return compact_hash::compact_hash_extended(p, n, 2, seed)[1];
+    }
+
+    // Integer fast path, keys up to 16 bytes zero-extended into two words.
+    uint64_t k_words(const uint8_t* p, size_t n, uint64_t seed) {
+        uint64_t m[2] = { 0, 0 };
+        memcpy(m, p, n);
+        return compact_hash::compact_hash_words(m[0], m[1], seed);
+    }
+
+    // Invertible integer mixer on keys up to 8 bytes. Unseeded, so the seed is
+    // folded into the key; mix64(0) == 0.
+    uint64_t k_mix64(const uint8_t* p, size_t n, uint64_t seed) {
+        uint64_t x = 0;
+        memcpy(&x, p, n);
+        return compact_hash::mix64(x ^ seed);
+    }
+
+    // Multi-buffer kernel: the key is lane 5 of 8, its neighbours are prefixes of it
+    // so lanes leave the common-block loop at different points.
+    uint64_t k_multi(const uint8_t* p, size_t n, uint64_t seed) {
+        const uint8_t* data[8];
+        size_t size[8];
+        uint64_t out[8];
+        for (size_t i = 0; i < 8; ++i) {
+            data[i] = p;
+            size[i] = n - std::min(n, (i * 7) % 20);
+        }
+        size[5] = n;
+        compact_hash::compact_hash_x8(data, size, out, seed);
+        return out[5];
+    }
+
+    struct Kernel {
+        const char* name;
+        uint64_t (*fn)(const uint8_t*, size_t, uint64_t);
+        size_t max_size;        // largest supported key in bytes, 0 = unlimited
+        bool hashes_length;     // false if keys are zero-extended to a fixed width
+    };
+
+    const Kernel KERNELS[] = {
+        { "compact_hash",          k_compact_hash, 0,  true },
+        { "CompactHash(stream)",   k_streaming,    0,  true },
+        { "compact_hash_extended", k_extended,     0,  true },
+        { "compact_hash_words",    k_words,        16, false },
+        { "mix64",                 k_mix64,        8,  false },
+        { "compact_hash_x8",       k_multi,        0,  true },
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Reporting
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    int failures = 0;
+    double scale = 1.0;
+
+    size_t scaled(size_t n) {
+        size_t s = static_cast<size_t>(n * scale);
+        return s < 16 ? 16 : s;
+    }
+
+    void verdict(const Kernel& k, const char* test, bool pass, const char* fmt, ...) {
+        char detail[256];
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(detail, sizeof(detail), fmt, ap);
+        va_end(ap);
+        printf("%-24s %-28s %-4s %s\n", k.name, test, pass ? "ok" : "FAIL", detail);
+        fflush(stdout);
+        if (!pass) ++failures;
+    }
+
+    bool supports(const Kernel& k, size_t size) { return k.max_size == 0 || size <= k.max_size; }
+
+    void random_bytes(RNG::SplitMix64& gen, uint8_t* p, size_t n) {
+        for (size_t i = 0; i < n; i += 8) {
+            uint64_t v = gen();
+            memcpy(p + i, &v, std::min<size_t>(8, n - i));
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Avalanche and bit independence
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    void avalanche(const Kernel& k, size_t size, size_t samples) {
+        if (!supports(k, size)) return;
+        RNG::SplitMix64 gen(size * 1000003ULL);
+        size_t bits = size * 8;
+        std::vector<uint32_t> flips(bits * 64, 0);
+        std::vector<uint8_t> key(size);
+        for (size_t s = 0; s < samples; ++s) {
+            random_bytes(gen, key.data(), size);
+            uint64_t h0 = k.fn(key.data(), size, 0);
+            for (size_t i = 0; i < bits; ++i) {
+                key[i >> 3] ^= static_cast<uint8_t>(1u << (i & 7));
+                uint64_t d = h0 ^ k.fn(key.data(), size, 0);
+                key[i >> 3] ^= static_cast<uint8_t>(1u << (i & 7));
+                uint32_t* row = &flips[i * 64];
+                for (; d; d &= d - 1) ++row[ctz64(d)];
+            }
+        }
+        double worst = 0;
+        for (uint32_t c : flips)
+            worst = std::max(worst, std::fabs(2.0 * c / samples - 1.0));
+        double limit = 6.0 / std::sqrt(static_cast<double>(samples));
+        char test[64];
+        snprintf(test, sizeof(test), "avalanche %zu-byte keys", size);
+        verdict(k, test, worst <= limit, "worst bias %.4f (limit %.4f, %zu keys)", worst, limit, samples);
+    }
+
+    void bit_independence(const Kernel& k, size_t size, size_t samples) {
+        if (!supports(k, size)) return;
+        RNG::SplitMix64 gen(size * 7919ULL);
+        std::vector<uint8_t> key(size);
+        // a spread of input bits keeps the pairwise accumulation affordable
+        const size_t bits = size * 8;
+        const size_t input_bits[] = { 0, 1, 7, 8, bits / 2 - 1, bits / 2, bits - 8, bits - 1 };
+        double worst = 0;
+        for (size_t ib : input_bits) {
+            std::vector<uint32_t> single(64, 0);
+            std::vector<uint32_t> pair(64 * 64, 0);
+            for (size_t s = 0; s < samples; ++s) {
+                random_bytes(gen, key.data(), size);
+                uint64_t h0 = k.fn(key.data(), size, 0);
+                key[ib >> 3] ^= static_cast<uint8_t>(1u << (ib & 7));
+                uint64_t d = h0 ^ k.fn(key.data(), size, 0);
+                for (uint64_t a = d; a; a &= a - 1) {
+                    int j = ctz64(a);
+                    ++single[j];
+                    for (uint64_t b = a & (a - 1); b; b &= b - 1) ++pair[j * 64 + ctz64(b)];
+                }
+            }
+            for (int j = 0; j < 64; ++j) {
+                for (int m = j + 1; m < 64; ++m) {
+                    double pj = static_cast<double>(single[j]) / samples, pm = static_cast<double>(single[m]) / samples;
+                    double cov = static_cast<double>(pair[j * 64 + m]) / samples - pj * pm;
+                    double denom = std::sqrt(pj * (1 - pj) * pm * (1 - pm));
+                    if (denom > 0) worst = std::max(worst, std::fabs(cov / denom));
+                }
+            }
+        }
+        double limit = 6.0 / std::sqrt(static_cast<double>(samples));
+        char test[64];
+        snprintf(test, sizeof(test), "bic %zu-byte keys", size);
+        verdict(k, test, worst <= limit, "worst |corr| %.4f (limit %.4f)", worst, limit);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Collision checks on structured key sets
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    size_t count_collisions(std::vector<uint64_t> v) {
+        std::sort(v.begin(), v.end());
+        size_t c = 0;
+        for (size_t i = 1; i < v.size(); ++i) c += v[i] == v[i - 1];
+        return c;
+    }
+
+    void collisions(const Kernel& k, const char* test, const std::vector<uint64_t>& hashes) {
+        size_t n = hashes.size();
+        double expected32 = static_cast<double>(n) * (n - 1) / 2.0 / 4294967296.0;
+        double limit32 = 2.0 * expected32 + 6.0 * std::sqrt(expected32) + 2.0;
+        std::vector<uint64_t> lo(n), hi(n);
+        for (size_t i = 0; i < n; ++i) {
+            lo[i] = hashes[i] & 0xffffffffULL;
+            hi[i] = hashes[i] >> 32;
+        }
+        size_t c64 = count_collisions(hashes), clo = count_collisions(lo), chi = count_collisions(hi);
+        bool pass = c64 == 0 && clo <= limit32 && chi <= limit32;
+        verdict(k, test, pass, "%zu keys: 64-bit %zu, low32 %zu, high32 %zu (expect %.1f, limit %.1f)",
+            n, c64, clo, chi, expected32, limit32);
+    }
+
+    // Every key of `size` bytes with at most `max_bits` bits set.
+    void sparse(const Kernel& k, size_t size, int max_bits) {
+        if (!supports(k, size)) return;
+        std::vector<uint64_t> hashes;
+        std::vector<uint8_t> key(size, 0);
+        const size_t bits = size * 8;
+        auto rec = [&](auto&& self, size_t start, int left) -> void {
+            hashes.push_back(k.fn(key.data(), size, 0));
+            if (left == 0) return;
+            for (size_t b = start; b < bits; ++b) {
+                key[b >> 3] ^= static_cast<uint8_t>(1u << (b & 7));
+                self(self, b + 1, left - 1);
+                key[b >> 3] ^= static_cast<uint8_t>(1u << (b & 7));
+            }
+        };
+        rec(rec, 0, max_bits);
+        char test[64];
+        snprintf(test, sizeof(test), "sparse %zuB <=%d bits", size, max_bits);
+        collisions(k, test, hashes);
+    }
+
+    // Keys consisting of a `block`-byte pattern (block <= 8) repeated to `size` bytes.
+    // Patterns are i * odd constant truncated to the block, which is a bijection on
+    // the block's bits, so the keys are distinct and any collision is the hash's.
+    void cyclic(const Kernel& k, size_t block, size_t size, size_t count) {
+        if (!supports(k, size)) return;
+        if (block < 8) count = std::min(count, size_t(1) << (8 * block));
+        std::vector<uint8_t> key(size);
+        std::vector<uint64_t> hashes;
+        hashes.reserve(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t pattern = i * 0x9e3779b97f4a7c15ULL;
+            memcpy(key.data(), &pattern, block);
+            for (size_t j = block; j < size; ++j) key[j] = key[j - block];
+            hashes.push_back(k.fn(key.data(), size, 0));
+        }
+        char test[64];
+        snprintf(test, sizeof(test), "cyclic %zuB x%zu", block, size / block);
+        collisions(k, test, hashes);
+    }
+
+    void low_entropy(const Kernel& k, size_t count) {
+        // zero keys of every length: only the length distinguishes them
+        std::vector<uint64_t> hashes;
+        if (k.hashes_length) {
+            size_t max_len = k.max_size ? k.max_size : 4096;
+            std::vector<uint8_t> zeros(max_len, 0);
+            for (size_t len = 0; len <= max_len; ++len) hashes.push_back(k.fn(zeros.data(), len, 0));
+            collisions(k, "zero keys 0..max bytes", hashes);
+        }
+
+        // little-endian counters, as 8-byte integer keys
+        hashes.clear();
+        for (uint64_t i = 0; i < count; ++i) hashes.push_back(k.fn(reinterpret_cast<const uint8_t*>(&i), 8, 0));
+        collisions(k, "counters 8B", hashes);
+
+        // short text keys such as "user:123456"
+        hashes.clear();
+        char text[32];
+        for (size_t i = 0; i < count; ++i) {
+            int len = snprintf(text, sizeof(text), "user:%zu", i);
+            if (!supports(k, static_cast<size_t>(len))) break;
+            hashes.push_back(k.fn(reinterpret_cast<const uint8_t*>(text), static_cast<size_t>(len), 0));
+        }
+        collisions(k, "text keys user:N", hashes);
+
+        // seeds: the same key under consecutive seeds
+        hashes.clear();
+        const uint8_t fixed[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        for (uint64_t s = 0; s < count; ++s) hashes.push_back(k.fn(fixed, 8, s));
+        collisions(k, "consecutive seeds", hashes);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Bucket distribution
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+    // z-score of the chi-square statistic; a good hash stays near 0, large positive
+    // values mean some buckets are crowded (long probe chains).
+    double bucket_z(const std::vector<uint64_t>& hashes, unsigned bits, bool high) {
+        std::vector<uint32_t> buckets(size_t(1) << bits, 0);
+        for (uint64_t h : hashes) ++buckets[high ? h >> (64 - bits) : h & ((1ULL << bits) - 1)];
+        double expected = static_cast<double>(hashes.size()) / buckets.size();
+        double chi2 = 0;
+        for (uint32_t c : buckets) chi2 += (c - expected) * (c - expected) / expected;
+        double dof = static_cast<double>(buckets.size() - 1);
+        return (chi2 - dof) / std::sqrt(2.0 * dof);
+    }
+
+    void buckets(const Kernel& k, size_t count) {
+        if (!supports(k, 8)) return;
+        const bool sparse = supports(k, 16);    // e.g. mix64 takes at most 8 bytes
+        std::vector<uint64_t> sequential, sparse_keys;
+        for (uint64_t i = 0; i < count; ++i) {
+            sequential.push_back(k.fn(reinterpret_cast<const uint8_t*>(&i), 8, 0));
+            if (!sparse) continue;
+            uint64_t sparse_pair[2] = { 1ULL << (i & 63), i >> 6 };   // distinct for every i
+            sparse_keys.push_back(k.fn(reinterpret_cast<const uint8_t*>(sparse_pair), 16, 0));
+        }
+        for (int set = 0; set < (sparse ? 2 : 1); ++set) {
+            const std::vector<uint64_t>& hs = set ? sparse_keys : sequential;
+            double worst = 0;
+            for (unsigned bits = 8; bits <= 20; bits += 4)
+                for (int high = 0; high < 2; ++high)
+                    worst = std::max(worst, bucket_z(hs, bits, high != 0));
+            verdict(k, set ? "buckets sparse 16B keys" : "buckets counters", worst <= 6.0,
+                "worst chi-square z %.2f over 2^8..2^20 buckets, low and high bits (limit 6)", worst);
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Multi-buffer equivalence with scalar compact_hash
+    /////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(COMPACT_HASH_MULTI_SIMD) && defined(__AVX512F__) && defined(__AVX512DQ__)
+    const char* const MULTI_BUILD = "x4 AVX2, x8 AVX-512";
+#elif defined(COMPACT_HASH_MULTI_SIMD) && defined(__AVX2__)
+    const char* const MULTI_BUILD = "x4 AVX2, x8 scalar";
+#else
+    const char* const MULTI_BUILD = "scalar";
+#endif
+
+    // Length mix: empty, under one block, exact blocks, and anything up to 600 bytes.
+    size_t random_length(RNG::SplitMix64& gen) {
+        switch (gen() % 4) {
+        case 0:  return gen() % 2 ? 0 : gen() % 16;
+        case 1:  return gen() % 16;
+        case 2:  return 16 * (gen() % 20);
+        default: return gen() % 601;
+        }
+    }
+
+    void multi_equivalence(const char* filter, size_t batches) {
+        static const Kernel x4 = { "compact_hash_x4", nullptr, 0, true };
+        static const Kernel x8 = { "compact_hash_x8", nullptr, 0, true };
+        static const Kernel multi = { "compact_hash_multi", nullptr, 0, true };
+        auto wanted = [&](const Kernel& k) { return !filter || strstr(k.name, filter); };
+
+        RNG::SplitMix64 gen(0x5eed);
+        std::vector<uint8_t> buffer(601 + 64);
+        std::vector<const uint8_t*> data;
+        std::vector<size_t> size;
+        std::vector<uint64_t> out, expect;
+        size_t bad4 = 0, bad8 = 0, bad_multi = 0, messages = 0;
+        for (size_t b = 0; b < batches; ++b) {
+            random_bytes(gen, buffer.data(), buffer.size());
+            const uint64_t seed = gen() % 4 ? gen() : 0;
+            const size_t n = gen() % 38;        // includes 0 and non-multiples of 4 and 8
+            data.resize(n);
+            size.resize(n);
+            out.assign(n, 0);
+            expect.resize(n);
+            for (size_t i = 0; i < n; ++i) {
+                size[i] = random_length(gen);
+                data[i] = buffer.data() + gen() % (buffer.size() - size[i] + 1);   // any alignment
+                expect[i] = compact_hash::compact_hash(data[i], size[i], seed);
+            }
+            messages += n;
+
+            compact_hash::compact_hash_multi(data.data(), size.data(), n, out.data(), seed);
+            for (size_t i = 0; i < n; ++i) bad_multi += out[i] != expect[i];
+            for (size_t i = 0; i + 4 <= n; i += 4) {
+                compact_hash::compact_hash_x4(&data[i], &size[i], &out[i], seed);
+                for (size_t j = i; j < i + 4; ++j) bad4 += out[j] != expect[j];
+            }
+            for (size_t i = 0; i + 8 <= n; i += 8) {
+                compact_hash::compact_hash_x8(&data[i], &size[i], &out[i], seed);
+                for (size_t j = i; j < i + 8; ++j) bad8 += out[j] != expect[j];
+            }
+        }
+        const char* fmt = "%zu lane mismatches in %zu batches, %zu messages (%s)";
+        if (wanted(x4)) verdict(x4, "equals compact_hash", bad4 == 0, fmt, bad4, batches, messages, MULTI_BUILD);
+        if (wanted(x8)) verdict(x8, "equals compact_hash", bad8 == 0, fmt, bad8, batches, messages, MULTI_BUILD);
+        if (wanted(multi)) verdict(multi, "equals compact_hash", bad_multi == 0, fmt, bad_multi, batches, messages, MULTI_BUILD);
+    }
+
+    bool parse_option(const char* arg, const char* name, const char*& value) {
+        size_t len = strlen(name);
+        if (strncmp(arg, name, len) != 0 || arg[len] != '=') return false;
+        value = arg + len + 1;
+        return true;
+    }
+
+}//namespace
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        const char* v;
+        if (parse_option(argv[i], "--filter", v)) filter = v;
+        else if (parse_option(argv[i], "--scale", v)) scale = strtod(v, nullptr);
+        else {
+            fprintf(stderr, "usage: %s [--filter=KERNEL] [--scale=F]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    for (const Kernel& k : KERNELS) {
+        if (filter && !strstr(k.name, filter)) continue;
+        for (size_t size : { 4, 8, 16, 32, 64 })
+            avalanche(k, size, scaled(size <= 16 ? 200000 : 50000));
+        for (size_t size : { 8, 16 })
+            bit_independence(k, size, scaled(100000));
+        sparse(k, 8, 4);
+        sparse(k, 16, 3);
+        sparse(k, 32, 3);
+        sparse(k, 256, 2);
+        for (size_t block : { 3, 4, 8 })
+            cyclic(k, block, block * 4, scaled(1000000));
+        low_entropy(k, scaled(1000000));
+        buckets(k, scaled(1 << 22));
+    }
+    multi_equivalence(filter, scaled(20000));
+    printf(failures ? "\n%d check(s) FAILED\n" : "\nall checks passed\n", failures);
+    return failures ? 1 : 0;
+}
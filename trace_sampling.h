@@ -0,0 +1,99 @@
+#pragma once
+// File: trace_sampling.h
+// Description: Consistent hash-based keep/drop decisions for distributed tracing
+// License: Public Domain (CC0 1.0) with option MIT license fallback
+
+#include <cstdint>      // uint64_t, uint8_t
+#include <cstddef>      // size_t
+#include <cstring>      // memcpy
+#include <string_view>  // std::string_view
+
+#include "compact_hash.h"
+
+/*
+compact_hash::TraceSampler - Same sampling decision for a trace in every service
+
+A trace is kept when compact_hash(trace_id, seed) < rate * 2^64. The decision
+depends only on the ID, the rate and the seed, so every service that sees the
+trace keeps or drops all of its spans alike, with no coordination and no extra
+propagated state. Because the threshold is monotone in the rate, the traces kept
+at rate r are a subset of those kept at any rate above r: a service sampling at
+10% keeps every trace that a 1% service keeps.
+
+All services must hash the same bytes (e.g. the 16 raw bytes of a W3C trace-id,
+not its hex text in one place and raw bytes in another) and use the same seed.
+The default seed is the fixed TRACE_SAMPLING_SEED, never the per-process seed.
+
+API:
+    TraceSampler s(rate, seed = TRACE_SAMPLING_SEED);     // rate in [0, 1]
+    bool keep = s.keep(id, size);                         // or keep(std::string_view)
+    size_t kept = s.keep_batch(ids, id_size, n, out);     // n fixed-width IDs, out[i] = 0/1
+    uint64_t t = s.threshold();
+
+Usage example:
+
+    compact_hash::TraceSampler sampler(0.05);
+    uint8_t trace_id[16] = ...;                           // from the traceparent header
+    if (sampler.keep(trace_id, sizeof(trace_id))) export_span(span);
+*/
+
+namespace compact_hash {
+
+    // Shared default so independently deployed services agree without configuration.
+    constexpr uint64_t TRACE_SAMPLING_SEED = 0x5452414345534d50ULL;   // "TRACESMP"
+
+    class TraceSampler {
+    public:
+        explicit TraceSampler(double rate, uint64_t seed = TRACE_SAMPLING_SEED) noexcept
+            : seeded(seed), keep_all(rate >= 1.0), limit(rate_to_threshold(rate)) {}
+
+        inline bool keep(const uint8_t* id, size_t size) const noexcept {
+            CompactHash h = seeded;
+            h.insert(id, size);
+            return decide(h.finalize());
+        }
+
+        inline bool keep(std::string_view id) const noexcept {
+            return keep(reinterpret_cast<const uint8_t*>(id.data()), id.size());
+        }
+
+        // Decide for n IDs of id_size bytes each, stored back to back (e.g. 16-byte
+        // trace IDs). out[i] is 1 to keep, 0 to drop; returns the number kept. 16-byte
+        // IDs go through insert_words(), skipping the block loop of insert().
+        size_t keep_batch(const uint8_t* ids, size_t id_size, size_t n, uint8_t* out) const noexcept {
+            size_t kept = 0;
+            if (id_size == 16) {
+                for (size_t i = 0; i < n; ++i) {
+                    uint64_t m[2];
+                    memcpy(m, ids + i * 16, 16);
+                    CompactHash h = seeded;
+                    h.insert_words(m[0], m[1]);
+                    kept += out[i] = decide(h.finalize());
+                }
+            }
+            else {
+                for (size_t i = 0; i < n; ++i) kept += out[i] = keep(ids + i * id_size, id_size);
+            }
+            return kept;
+        }
+
+        // Hashes below the threshold are kept (every hash when the rate is 1).
+        uint64_t threshold() const noexcept { return limit; }
+
+    private:
+        static uint64_t rate_to_threshold(double rate) noexcept {
+            if (!(rate > 0.0)) return 0;                        // also NaN
+            if (rate >= 1.0) return UINT64_MAX;
+            return static_cast<uint64_t>(rate * 18446744073709551616.0);   // rate * 2^64 < 2^64
+        }
+
+        inline uint8_t decide(uint64_t hash) const noexcept {
+            return static_cast<uint8_t>(keep_all | (hash < limit));
+        }
+
+        CompactHash seeded;
+        bool keep_all;
+        uint64_t limit;
+    };//class TraceSampler
+
+}//namespace compact_hash